@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/pm_bench.dir/bench/pipeline_bench.cpp.o"
+  "CMakeFiles/pm_bench.dir/bench/pipeline_bench.cpp.o.d"
+  "bin/pm_bench"
+  "bin/pm_bench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/pm_bench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/pm_lodbench.dir/bench/lod_bench.cpp.o"
+  "CMakeFiles/pm_lodbench.dir/bench/lod_bench.cpp.o.d"
+  "bin/pm_lodbench"
+  "bin/pm_lodbench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/pm_lodbench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
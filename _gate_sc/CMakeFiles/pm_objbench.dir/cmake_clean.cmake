@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/pm_objbench.dir/bench/objload_bench.cpp.o"
+  "CMakeFiles/pm_objbench.dir/bench/objload_bench.cpp.o.d"
+  "bin/pm_objbench"
+  "bin/pm_objbench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/pm_objbench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/pm_scaling.dir/bench/scaling_bench.cpp.o"
+  "CMakeFiles/pm_scaling.dir/bench/scaling_bench.cpp.o.d"
+  "bin/pm_scaling"
+  "bin/pm_scaling.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/pm_scaling.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
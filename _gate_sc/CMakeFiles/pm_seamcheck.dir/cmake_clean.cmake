@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/pm_seamcheck.dir/bench/seam_check.cpp.o"
+  "CMakeFiles/pm_seamcheck.dir/bench/seam_check.cpp.o.d"
+  "bin/pm_seamcheck"
+  "bin/pm_seamcheck.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/pm_seamcheck.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/pm_splitcheck.dir/bench/split_check.cpp.o"
+  "CMakeFiles/pm_splitcheck.dir/bench/split_check.cpp.o.d"
+  "bin/pm_splitcheck"
+  "bin/pm_splitcheck.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/pm_splitcheck.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
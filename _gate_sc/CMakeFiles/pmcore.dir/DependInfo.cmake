@@ -0,0 +1,35 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/src/core/JobSystem.cpp" "CMakeFiles/pmcore.dir/src/core/JobSystem.cpp.o" "gcc" "CMakeFiles/pmcore.dir/src/core/JobSystem.cpp.o.d"
+  "/root/repo/src/core/Stats.cpp" "CMakeFiles/pmcore.dir/src/core/Stats.cpp.o" "gcc" "CMakeFiles/pmcore.dir/src/core/Stats.cpp.o.d"
+  "/root/repo/src/io/MappedFile.cpp" "CMakeFiles/pmcore.dir/src/io/MappedFile.cpp.o" "gcc" "CMakeFiles/pmcore.dir/src/io/MappedFile.cpp.o.d"
+  "/root/repo/src/mesh/CollapseHeap.cpp" "CMakeFiles/pmcore.dir/src/mesh/CollapseHeap.cpp.o" "gcc" "CMakeFiles/pmcore.dir/src/mesh/CollapseHeap.cpp.o.d"
+  "/root/repo/src/mesh/EdgeTable.cpp" "CMakeFiles/pmcore.dir/src/mesh/EdgeTable.cpp.o" "gcc" "CMakeFiles/pmcore.dir/src/mesh/EdgeTable.cpp.o.d"
+  "/root/repo/src/mesh/Mesh.cpp" "CMakeFiles/pmcore.dir/src/mesh/Mesh.cpp.o" "gcc" "CMakeFiles/pmcore.dir/src/mesh/Mesh.cpp.o.d"
+  "/root/repo/src/mesh/ViewRefiner.cpp" "CMakeFiles/pmcore.dir/src/mesh/ViewRefiner.cpp.o" "gcc" "CMakeFiles/pmcore.dir/src/mesh/ViewRefiner.cpp.o.d"
+  "/root/repo/src/mesh/meshCluster.cpp" "CMakeFiles/pmcore.dir/src/mesh/meshCluster.cpp.o" "gcc" "CMakeFiles/pmcore.dir/src/mesh/meshCluster.cpp.o.d"
+  "/root/repo/src/mesh/meshGen.cpp" "CMakeFiles/pmcore.dir/src/mesh/meshGen.cpp.o" "gcc" "CMakeFiles/pmcore.dir/src/mesh/meshGen.cpp.o.d"
+  "/root/repo/src/mesh/meshWeld.cpp" "CMakeFiles/pmcore.dir/src/mesh/meshWeld.cpp.o" "gcc" "CMakeFiles/pmcore.dir/src/mesh/meshWeld.cpp.o.d"
+  "/root/repo/src/mesh/objLoader.cpp" "CMakeFiles/pmcore.dir/src/mesh/objLoader.cpp.o" "gcc" "CMakeFiles/pmcore.dir/src/mesh/objLoader.cpp.o.d"
+  "/root/repo/src/mesh/pMesh.cpp" "CMakeFiles/pmcore.dir/src/mesh/pMesh.cpp.o" "gcc" "CMakeFiles/pmcore.dir/src/mesh/pMesh.cpp.o.d"
+  "/root/repo/src/mesh/pmBuild.cpp" "CMakeFiles/pmcore.dir/src/mesh/pmBuild.cpp.o" "gcc" "CMakeFiles/pmcore.dir/src/mesh/pmBuild.cpp.o.d"
+  "/root/repo/src/mesh/pmFile.cpp" "CMakeFiles/pmcore.dir/src/mesh/pmFile.cpp.o" "gcc" "CMakeFiles/pmcore.dir/src/mesh/pmFile.cpp.o.d"
+  "/root/repo/src/mesh/pmLayout.cpp" "CMakeFiles/pmcore.dir/src/mesh/pmLayout.cpp.o" "gcc" "CMakeFiles/pmcore.dir/src/mesh/pmLayout.cpp.o.d"
+  "/root/repo/src/mesh/pmStream.cpp" "CMakeFiles/pmcore.dir/src/mesh/pmStream.cpp.o" "gcc" "CMakeFiles/pmcore.dir/src/mesh/pmStream.cpp.o.d"
+  "/root/repo/src/scene/LodManager.cpp" "CMakeFiles/pmcore.dir/src/scene/LodManager.cpp.o" "gcc" "CMakeFiles/pmcore.dir/src/scene/LodManager.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
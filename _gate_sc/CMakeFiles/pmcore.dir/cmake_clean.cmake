@@ -0,0 +1,43 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/pmcore.dir/src/core/JobSystem.cpp.o"
+  "CMakeFiles/pmcore.dir/src/core/JobSystem.cpp.o.d"
+  "CMakeFiles/pmcore.dir/src/core/Stats.cpp.o"
+  "CMakeFiles/pmcore.dir/src/core/Stats.cpp.o.d"
+  "CMakeFiles/pmcore.dir/src/io/MappedFile.cpp.o"
+  "CMakeFiles/pmcore.dir/src/io/MappedFile.cpp.o.d"
+  "CMakeFiles/pmcore.dir/src/mesh/CollapseHeap.cpp.o"
+  "CMakeFiles/pmcore.dir/src/mesh/CollapseHeap.cpp.o.d"
+  "CMakeFiles/pmcore.dir/src/mesh/EdgeTable.cpp.o"
+  "CMakeFiles/pmcore.dir/src/mesh/EdgeTable.cpp.o.d"
+  "CMakeFiles/pmcore.dir/src/mesh/Mesh.cpp.o"
+  "CMakeFiles/pmcore.dir/src/mesh/Mesh.cpp.o.d"
+  "CMakeFiles/pmcore.dir/src/mesh/ViewRefiner.cpp.o"
+  "CMakeFiles/pmcore.dir/src/mesh/ViewRefiner.cpp.o.d"
+  "CMakeFiles/pmcore.dir/src/mesh/meshCluster.cpp.o"
+  "CMakeFiles/pmcore.dir/src/mesh/meshCluster.cpp.o.d"
+  "CMakeFiles/pmcore.dir/src/mesh/meshGen.cpp.o"
+  "CMakeFiles/pmcore.dir/src/mesh/meshGen.cpp.o.d"
+  "CMakeFiles/pmcore.dir/src/mesh/meshWeld.cpp.o"
+  "CMakeFiles/pmcore.dir/src/mesh/meshWeld.cpp.o.d"
+  "CMakeFiles/pmcore.dir/src/mesh/objLoader.cpp.o"
+  "CMakeFiles/pmcore.dir/src/mesh/objLoader.cpp.o.d"
+  "CMakeFiles/pmcore.dir/src/mesh/pMesh.cpp.o"
+  "CMakeFiles/pmcore.dir/src/mesh/pMesh.cpp.o.d"
+  "CMakeFiles/pmcore.dir/src/mesh/pmBuild.cpp.o"
+  "CMakeFiles/pmcore.dir/src/mesh/pmBuild.cpp.o.d"
+  "CMakeFiles/pmcore.dir/src/mesh/pmFile.cpp.o"
+  "CMakeFiles/pmcore.dir/src/mesh/pmFile.cpp.o.d"
+  "CMakeFiles/pmcore.dir/src/mesh/pmLayout.cpp.o"
+  "CMakeFiles/pmcore.dir/src/mesh/pmLayout.cpp.o.d"
+  "CMakeFiles/pmcore.dir/src/mesh/pmStream.cpp.o"
+  "CMakeFiles/pmcore.dir/src/mesh/pmStream.cpp.o.d"
+  "CMakeFiles/pmcore.dir/src/scene/LodManager.cpp.o"
+  "CMakeFiles/pmcore.dir/src/scene/LodManager.cpp.o.d"
+  "libpmcore.a"
+  "libpmcore.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/pmcore.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
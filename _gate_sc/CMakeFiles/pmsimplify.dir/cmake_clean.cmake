@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/pmsimplify.dir/tools/pmsimplify.cpp.o"
+  "CMakeFiles/pmsimplify.dir/tools/pmsimplify.cpp.o.d"
+  "bin/pmsimplify"
+  "bin/pmsimplify.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/pmsimplify.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,193 @@
+#include <stdio.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <array>
+#include <random>
+#include <algorithm>
+#include <filesystem>
+
+#include <glad/glad.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include "core/Stats.h"
+#include "mesh/Mesh.h"
+#include "mesh/pMesh.h"
+#include "render/MeshRenderer.h"
+
+namespace fs = std::filesystem;
+
+/*
+	pm_glcheck
+	Drives MeshRenderer's incremental index uploads against a real GL
+	context with no window: EGL on Mesa's surfaceless platform, so it runs
+	on the llvmpipe software rasteriser (LIBGL_ALWAYS_SOFTWARE=1 forces it
+	where there is a GPU).
+
+		pm_glcheck [-f frames] [-s seeks] [models...]
+
+	Per model it drags the LOD one step per frame for `frames` frames, down
+	then back up, and then jumps to `seeks` random steps. After every
+	UpdateIndices the EBO is read back and must match the mesh's index
+	array slot for slot; every 100 frames and after each seek it must also
+	hold the same triangles as a full rebuild. It prints the bytes the
+	incremental path uploaded next to what a full upload per frame would
+	have sent, and exits 1 on any mismatch.
+*/
+
+// corners rotated so the smallest comes first, winding kept, then sorted
+static std::vector<std::array<unsigned int, 3>> triangleSet(const unsigned int *indices, size_t count)
+{
+	std::vector<std::array<unsigned int, 3>> tris(count / 3);
+	for (size_t i = 0; i < tris.size(); ++i)
+	{
+		const unsigned int *t = indices + 3 * i;
+		int k = t[1] < t[0] ? (t[2] < t[1] ? 2 : 1) : (t[2] < t[0] ? 2 : 0);
+		tris[i] = {t[k], t[(k + 1) % 3], t[(k + 2) % 3]};
+	}
+	std::sort(tris.begin(), tris.end());
+	return tris;
+}
+
+static bool createContext()
+{
+	EGLDisplay display = EGL_NO_DISPLAY;
+	auto platformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (platformDisplay)
+		display = platformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	if (display == EGL_NO_DISPLAY)
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+	EGLint major, minor, configs = 0;
+	EGLConfig config;
+	// no window, and the default surface type would ask for one
+	const EGLint configAttribs[] = {EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+	if (!eglInitialize(display, &major, &minor) || !eglBindAPI(EGL_OPENGL_API) ||
+		!eglChooseConfig(display, configAttribs, &config, 1, &configs) || configs == 0)
+		return false;
+
+	// the viewer's context: 3.3 core
+	const EGLint contextAttribs[] = {EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 3,
+									 EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, EGL_NONE};
+	EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+	if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+		return false;
+
+	return gladLoadGLLoader((GLADloadproc)eglGetProcAddress) != 0;
+}
+
+int main(int argc, char *argv[])
+{
+	std::vector<std::string> files;
+	int frames = 3000;
+	int seeks = 200;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		if (arg == "-f" && i + 1 < argc)
+			frames = std::max(1, std::stoi(argv[++i]));
+		else if (arg == "-s" && i + 1 < argc)
+			seeks = std::max(0, std::stoi(argv[++i]));
+		else
+			files.push_back(arg);
+	}
+
+	if (files.empty())
+	{
+		std::error_code error;
+		for (const auto &entry : fs::directory_iterator("data/models", error))
+			if (entry.path().extension() == ".obj")
+				files.push_back(entry.path().string());
+	}
+	if (files.empty())
+	{
+		fprintf(stderr, "no models found, run from the repo root or pass model paths\n");
+		return 1;
+	}
+	std::sort(files.begin(), files.end());
+
+	if (!createContext())
+	{
+		std::cerr << "no headless GL 3.3 context (EGL)\n";
+		return 1;
+	}
+	printf("GL %s, %s\n", (const char *)glGetString(GL_VERSION), (const char *)glGetString(GL_RENDERER));
+	printf("%-16s %7s %7s %9s %12s %12s %12s %12s\n", "model", "steps", "checks", "failures",
+		   "drag MB", "full MB", "seek MB", "full MB");
+
+	bool ok = true;
+	std::vector<unsigned int> readBack;
+	for (const auto &path : files)
+	{
+		Mesh mesh(path);
+		mesh.setPlacement(Placement::Optimal);
+		pMesh pm(mesh);
+
+		MeshRenderer renderer;
+		renderer.Upload(pm.Current());
+
+		int checks = 0, failures = 0;
+		auto check = [&](bool full)
+		{
+			const std::vector<unsigned int> &indices = pm.Current().getIndices();
+			readBack.assign(static_cast<size_t>(renderer.IndexCount()), 0);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderer.IndexBuffer());
+			glGetBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, readBack.size() * sizeof(GLuint), readBack.data());
+
+			bool same = readBack == indices;
+			if (same && full)
+			{
+				Mesh rebuilt(pm.Current());
+				rebuilt.updateIndices();
+				const std::vector<unsigned int> &all = rebuilt.getIndices();
+				same = triangleSet(readBack.data(), readBack.size()) == triangleSet(all.data(), all.size());
+			}
+			++checks;
+			failures += same ? 0 : 1;
+		};
+
+		// what the index uploads of a stretch of frames cost, next to a full
+		// upload of the index array every frame
+		uint64_t incremental = 0, full = 0;
+		auto show = [&](int step)
+		{
+			uint64_t before = statsSnapshot()[Stat::BytesUploaded];
+			pm.UpdateToStep(step);
+			if (pm.MovesVertices())
+				renderer.UpdateVertices(pm.Current());
+			uint64_t vertexBytes = statsSnapshot()[Stat::BytesUploaded] - before;
+			renderer.UpdateIndices(pm.Current());
+			incremental += statsSnapshot()[Stat::BytesUploaded] - before - vertexBytes;
+			full += pm.Current().getIndices().size() * sizeof(GLuint);
+		};
+
+		int steps = std::min(frames / 2, pm.HistorySize());
+		for (int f = 0; f < 2 * steps; ++f)
+		{
+			show(f < steps ? f + 1 : 2 * steps - f - 1);
+			check(f % 100 == 99);
+		}
+		check(true);
+		uint64_t dragBytes = incremental, dragFull = full;
+
+		incremental = full = 0;
+		std::mt19937 rng(1);
+		for (int s = 0; s < seeks; ++s)
+		{
+			show(static_cast<int>(rng() % (pm.HistorySize() + 1)));
+			check(true);
+		}
+
+		printf("%-16s %7d %7d %9d %12.2f %12.2f %12.2f %12.2f\n", fs::path(path).filename().string().c_str(),
+			   2 * steps, checks, failures, dragBytes / 1048576.0, dragFull / 1048576.0,
+			   incremental / 1048576.0, full / 1048576.0);
+		ok &= failures == 0;
+	}
+
+	if (!statsEnabled())
+		printf("built with PM_NO_STATS, upload sizes are not counted\n");
+	printf("%s\n", ok ? "ok" : "MISMATCH");
+	return ok ? 0 : 1;
+}
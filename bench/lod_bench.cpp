@@ -0,0 +1,231 @@
+#include <stdio.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <algorithm>
+#include <filesystem>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "mesh/Mesh.h"
+#include "mesh/pMesh.h"
+#include "scene/LodManager.h"
+
+namespace fs = std::filesystem;
+
+/*
+	pm_lodbench
+	Scatters instances of the given models over a field, flies a camera
+	over it and times LodManager::update per frame, with and without a
+	triangle budget. Without a budget every group's instance count is
+	checked against a plain per-instance recomputation of the cull and
+	level choice. The default budget (-b, 100000) sits well under what the
+	bundled models draw unbudgeted, about 285000 triangles, so the search
+	for a tolerance scale and the over-budget check both run.
+*/
+
+// instances per (asset, level), recomputed the slow way
+static std::vector<uint32_t> referenceGroups(const LodManager &lods, const std::vector<int> &assetOf,
+											 const std::vector<glm::mat4> &transforms,
+											 const glm::mat4 &viewProj, const LodSettings &settings,
+											 const std::vector<glm::vec4> &spheres, int maxLevels)
+{
+	std::vector<uint32_t> groups(lods.AssetCount() * maxLevels, 0);
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; ++i)
+		rows[i] = glm::vec4(viewProj[0][i], viewProj[1][i], viewProj[2][i], viewProj[3][i]);
+	glm::vec4 planes[6] = {rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1],
+						   rows[3] - rows[1], rows[3] + rows[2], rows[3] - rows[2]};
+	float pixelsPerUnit = glm::length(glm::vec3(rows[1])) * settings.viewportHeight * 0.5f;
+
+	for (size_t i = 0; i < transforms.size(); ++i)
+	{
+		const glm::mat4 &m = transforms[i];
+		float s = std::max({glm::length(glm::vec3(m[0])), glm::length(glm::vec3(m[1])), glm::length(glm::vec3(m[2]))});
+		glm::vec3 c = glm::vec3(m * glm::vec4(glm::vec3(spheres[assetOf[i]]), 1.0f));
+		float r = spheres[assetOf[i]].w * s;
+
+		bool inside = true;
+		for (const glm::vec4 &p : planes)
+			inside &= glm::dot(glm::vec3(p), c) + p.w >= -r * glm::length(glm::vec3(p));
+		if (!inside)
+			continue;
+
+		float w = glm::dot(glm::vec3(rows[3]), c) + rows[3].w - r * glm::length(glm::vec3(rows[3]));
+		float tolerance = std::max(w, 0.0f) * settings.pixelError / pixelsPerUnit / s;
+		// rounded down to the manager's quarter octaves
+		if (tolerance > 0.0f)
+		{
+			float b = std::clamp(std::floor(4.0f * std::log2(tolerance)), -float(LodManager::kBucketOne),
+								 float(LodManager::kBuckets - 1 - LodManager::kBucketOne));
+			tolerance = std::exp2(b * 0.25f);
+		}
+
+		const pmLayout &layout = lods.Layout(assetOf[i]);
+		int level = 0;
+		while (level + 1 < static_cast<int>(layout.levels.size()) &&
+			   layout.levels[level + 1].error <= tolerance)
+			++level;
+		groups[assetOf[i] * maxLevels + level]++;
+	}
+	return groups;
+}
+
+int main(int argc, char *argv[])
+{
+	std::vector<std::string> files;
+	int instances = 50000;
+	int frames = 200;
+	uint64_t budget = 100000;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		if (arg == "-n" && i + 1 < argc)
+			instances = std::max(1, std::stoi(argv[++i]));
+		else if (arg == "-f" && i + 1 < argc)
+			frames = std::max(1, std::stoi(argv[++i]));
+		else if (arg == "-b" && i + 1 < argc)
+			budget = std::stoull(argv[++i]);
+		else
+			files.push_back(arg);
+	}
+
+	if (files.empty())
+	{
+		std::error_code error;
+		for (const auto &entry : fs::directory_iterator("data/models", error))
+			if (entry.path().extension() == ".obj")
+				files.push_back(entry.path().string());
+	}
+	if (files.empty())
+	{
+		fprintf(stderr, "no models found, run from the repo root or pass model paths\n");
+		return 1;
+	}
+	std::sort(files.begin(), files.end());
+
+	LodManager lods;
+	std::vector<glm::vec4> spheres;
+	float spacing = 0.0f;
+	int maxLevels = 0;
+	for (const auto &path : files)
+	{
+		Mesh mesh(path);
+		mesh.setPlacement(Placement::Optimal);
+		pMesh pm(mesh);
+		int asset = lods.addAsset(pm);
+
+		// the manager's sphere is private, measure the same one here
+		const pmLayout &layout = lods.Layout(asset);
+		glm::vec3 lo(1e30f), hi(-1e30f);
+		for (const Vertex &v : layout.vertices)
+		{
+			lo = glm::min(lo, v.Position);
+			hi = glm::max(hi, v.Position);
+		}
+		glm::vec3 center = (lo + hi) * 0.5f;
+		float radius = 0.0f;
+		for (const Vertex &v : layout.vertices)
+			radius = std::max(radius, glm::length(v.Position - center));
+		spheres.push_back(glm::vec4(center, radius));
+		spacing = std::max(spacing, 3.0f * radius);
+		maxLevels = std::max(maxLevels, static_cast<int>(layout.levels.size()));
+
+		printf("asset %-20s %7d verts %3zu levels, full %u tris\n", fs::path(path).filename().string().c_str(),
+			   pm.MaxVerts(), layout.levels.size(), layout.levels.front().indexCount / 3);
+	}
+	if (lods.AssetCount() == 0)
+	{
+		std::cerr << "no models\n";
+		return 1;
+	}
+
+	// a square field, random asset, yaw and size per instance
+	std::mt19937 rng(1);
+	float side = spacing * std::sqrt(static_cast<float>(instances));
+	std::uniform_real_distribution<float> along(-0.5f * side, 0.5f * side), unit(0.0f, 1.0f);
+	std::vector<int> assetOf;
+	std::vector<glm::mat4> transforms;
+	for (int i = 0; i < instances; ++i)
+	{
+		int asset = static_cast<int>(rng() % lods.AssetCount());
+		float s = 0.5f + 1.5f * unit(rng);
+		float yaw = 6.2831853f * unit(rng);
+		glm::mat4 m(1.0f);
+		m[0] = glm::vec4(s * std::cos(yaw), 0.0f, -s * std::sin(yaw), 0.0f);
+		m[1] = glm::vec4(0.0f, s, 0.0f, 0.0f);
+		m[2] = glm::vec4(s * std::sin(yaw), 0.0f, s * std::cos(yaw), 0.0f);
+		m[3] = glm::vec4(along(rng), 0.0f, along(rng), 1.0f);
+		assetOf.push_back(asset);
+		transforms.push_back(m);
+		lods.addInstance(asset, m);
+	}
+
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.01f * spacing, 4.0f * side);
+	auto viewAt = [&](int frame)
+	{
+		float t = 6.2831853f * frame / frames;
+		glm::vec3 eye(0.3f * side * std::cos(t), 2.0f * spacing, 0.3f * side * std::sin(t));
+		glm::vec3 at(0.0f, 0.0f, 0.0f);
+		return projection * glm::lookAt(eye, at, glm::vec3(0.0f, 1.0f, 0.0f));
+	};
+
+	printf("\n%d instances, %d frames\n", instances, frames);
+	printf("%-10s %10s %10s %10s %8s %12s %8s\n", "budget", "update ms", "ns/inst", "visible", "draws", "triangles", "scale");
+
+	const float maxScale = std::exp2((LodManager::kBuckets - 1) * 0.25f);
+	bool ok = true;
+	for (uint64_t b : {uint64_t(0), budget})
+	{
+		LodSettings settings;
+		settings.triangleBudget = b;
+
+		double total = 0.0;
+		uint64_t visible = 0, draws = 0, triangles = 0;
+		float scale = 0.0f;
+		int mismatched = 0;
+		for (int f = 0; f < frames; ++f)
+		{
+			glm::mat4 viewProj = viewAt(f);
+			auto start = std::chrono::steady_clock::now();
+			lods.update(viewProj, settings);
+			total += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			visible += lods.Stats().visible;
+			draws += lods.Draws().size();
+			triangles += lods.Stats().triangles;
+			scale = std::max(scale, lods.Stats().toleranceScale);
+			// only allowed over budget once everything is at its coarsest
+			if (b > 0 && lods.Stats().triangles > b && lods.Stats().toleranceScale < maxScale)
+				ok = false;
+
+			if (b == 0)
+			{
+				std::vector<uint32_t> expected = referenceGroups(lods, assetOf, transforms, viewProj,
+																 settings, spheres, maxLevels);
+				std::vector<uint32_t> got(expected.size(), 0);
+				for (const LodDraw &d : lods.Draws())
+					got[d.asset * maxLevels + d.level] += d.instanceCount;
+				for (size_t g = 0; g < got.size(); ++g)
+					mismatched += std::abs(static_cast<int>(got[g]) - static_cast<int>(expected[g]));
+			}
+		}
+
+		printf("%-10s %10.3f %10.2f %10llu %8llu %12llu %7.3gx", b ? std::to_string(b).c_str() : "none",
+			   total * 1e3 / frames, total * 1e9 / (double(frames) * instances),
+			   (unsigned long long)(visible / frames), (unsigned long long)(draws / frames),
+			   (unsigned long long)(triangles / frames), scale);
+		if (b == 0)
+			printf("  reference mismatches %d", mismatched);
+		printf("\n");
+		// float rounding may put an instance on a bucket edge, a handful is fine
+		ok &= mismatched <= instances / 10000 + frames;
+	}
+
+	return ok ? 0 : 1;
+}
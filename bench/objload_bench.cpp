@@ -0,0 +1,177 @@
+#include <stdio.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <filesystem>
+
+#include "mesh/Mesh.h"
+#include "mesh/objLoader.h"
+
+namespace fs = std::filesystem;
+
+/*
+	pm_objbench
+	Times the memory-mapped loadOBJ against the original loadOBJStream on
+	the given files and on synthetic grids, and checks that both produce
+	identical vertices, triangles and indices.
+*/
+
+using LoaderFn = bool (*)(const std::string &, std::vector<Vertex> &,
+						  std::vector<Triangle> &, std::vector<unsigned int> &);
+
+struct LoadResult
+{
+	std::vector<Vertex> vertices;
+	std::vector<Triangle> triangles;
+	std::vector<unsigned int> indices;
+};
+
+// writes an n x n quad grid with uvs and normals, 2 * n * n triangles
+static std::string writeGrid(const fs::path &dir, int n)
+{
+	fs::path path = dir / ("grid_" + std::to_string(2 * n * n) + ".obj");
+	std::ofstream file(path);
+
+	char line[128];
+	for (int y = 0; y <= n; ++y)
+	{
+		for (int x = 0; x <= n; ++x)
+		{
+			float fx = float(x) / n, fy = float(y) / n;
+			float h = 0.05f * std::sin(fx * 12.0f) * std::cos(fy * 9.0f);
+			snprintf(line, sizeof(line), "v %f %f %f\n", fx, h, fy);
+			file << line;
+		}
+	}
+	for (int y = 0; y <= n; ++y)
+	{
+		for (int x = 0; x <= n; ++x)
+		{
+			snprintf(line, sizeof(line), "vt %f %f\n", float(x) / n, float(y) / n);
+			file << line;
+		}
+	}
+	file << "vn 0 1 0\n";
+
+	for (int y = 0; y < n; ++y)
+	{
+		for (int x = 0; x < n; ++x)
+		{
+			int a = y * (n + 1) + x + 1, b = a + 1, c = a + n + 1, d = c + 1;
+			snprintf(line, sizeof(line), "f %d/%d/1 %d/%d/1 %d/%d/1\n", a, a, c, c, b, b);
+			file << line;
+			snprintf(line, sizeof(line), "f %d/%d/1 %d/%d/1 %d/%d/1\n", b, b, c, c, d, d);
+			file << line;
+		}
+	}
+
+	return path.string();
+}
+
+static double timeLoader(LoaderFn fn, const std::string &path, int runs, LoadResult &out)
+{
+	std::vector<double> times;
+
+	// the loaders report to std::cout, silence them while timing
+	std::ostringstream sink;
+	auto *old = std::cout.rdbuf(sink.rdbuf());
+
+	for (int r = 0; r < runs; ++r)
+	{
+		out = LoadResult();
+		auto start = std::chrono::steady_clock::now();
+		fn(path, out.vertices, out.triangles, out.indices);
+		times.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+	}
+
+	std::cout.rdbuf(old);
+
+	std::sort(times.begin(), times.end());
+	return times[times.size() / 2];
+}
+
+static bool sameOutput(const LoadResult &a, const LoadResult &b)
+{
+	if (a.vertices.size() != b.vertices.size() ||
+		a.triangles.size() != b.triangles.size() ||
+		a.indices != b.indices)
+		return false;
+
+	for (size_t i = 0; i < a.vertices.size(); ++i)
+	{
+		const Vertex &va = a.vertices[i], &vb = b.vertices[i];
+		if (va.Position != vb.Position || va.Normal != vb.Normal || va.TexCoords != vb.TexCoords)
+			return false;
+	}
+
+	for (size_t i = 0; i < a.triangles.size(); ++i)
+		if (a.triangles[i].verts != b.triangles[i].verts)
+			return false;
+
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	std::vector<std::string> files;
+	std::vector<int> synthetic;
+	int runs = 5;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		if (arg == "-n" && i + 1 < argc)
+			runs = std::max(1, std::stoi(argv[++i]));
+		else if (arg == "--synthetic" && i + 1 < argc)
+			synthetic.push_back(std::stoi(argv[++i]));
+		else
+			files.push_back(arg);
+	}
+
+	if (files.empty() && synthetic.empty())
+	{
+		files.push_back("data/models/bunny_40k.obj");
+		synthetic = {1000000, 4000000};
+	}
+
+	fs::path tmp = fs::temp_directory_path() / "pm_objbench";
+	fs::create_directories(tmp);
+	for (int tris : synthetic)
+	{
+		int n = std::max(1, static_cast<int>(std::sqrt(tris / 2.0)));
+		files.push_back(writeGrid(tmp, n));
+	}
+
+	printf("%-28s %10s %10s %12s %12s %8s %6s\n",
+		   "file", "MB", "tris", "stream ms", "mmap ms", "speedup", "match");
+
+	bool allMatch = true;
+	for (const auto &path : files)
+	{
+		if (!fs::exists(path))
+		{
+			std::cerr << "missing input: " << path << "\n";
+			continue;
+		}
+
+		double mb = fs::file_size(path) / (1024.0 * 1024.0);
+
+		LoadResult ref, fast;
+		double tStream = timeLoader(loadOBJStream, path, runs, ref);
+		double tMmap = timeLoader(loadOBJ, path, runs, fast);
+		bool match = sameOutput(ref, fast);
+		allMatch &= match;
+
+		printf("%-28s %10.2f %10zu %12.2f %12.2f %7.2fx %6s\n",
+			   fs::path(path).filename().string().c_str(), mb, fast.triangles.size(),
+			   tStream * 1e3, tMmap * 1e3, tStream / tMmap, match ? "yes" : "NO");
+	}
+
+	fs::remove_all(tmp);
+	return allMatch ? 0 : 1;
+}
@@ -0,0 +1,251 @@
+#include <stdio.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <algorithm>
+#include <filesystem>
+
+#include "core/JobSystem.h"
+#include "mesh/Mesh.h"
+#include "mesh/objLoader.h"
+#include "mesh/pMesh.h"
+
+namespace fs = std::filesystem;
+
+/*
+	pm_bench
+	Times each stage of the pipeline on its own, per model: OBJ parse,
+	initial quadrics, collapse queue, pMesh::Initialize, Update down to the
+	base and back up, UpdateToStep seeks and a full index rebuild.
+
+	Every stage runs once untimed, then until it has both --runs samples
+	and --min-time seconds of them. Reported are the median, 10th and 90th
+	percentiles and the median throughput in the stage's own unit.
+
+		pm_bench [--runs n] [--min-time s] [--json file|-] [models...]
+
+	Without models it runs every OBJ in data/models, smallest first.
+*/
+
+struct StageResult
+{
+	std::string model;
+	std::string stage;
+	std::string unit; // what the throughput counts
+	double items = 0.0;
+	std::vector<double> ms; // sorted
+};
+
+struct BenchSettings
+{
+	int runs = 10;
+	double minTime = 0.5;
+	int maxRuns = 1000;
+};
+
+// nearest rank
+static double percentile(const std::vector<double> &sorted, double p)
+{
+	size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+	return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+// setup() runs before every sample, untimed; fn() is the sample
+template <typename Setup, typename Fn>
+static std::vector<double> measure(const BenchSettings &settings, Setup &&setup, Fn &&fn)
+{
+	setup();
+	fn();
+
+	std::vector<double> ms;
+	double total = 0.0;
+	while (ms.size() < static_cast<size_t>(settings.maxRuns) &&
+		   (ms.size() < static_cast<size_t>(settings.runs) || total < settings.minTime))
+	{
+		setup();
+		auto start = std::chrono::steady_clock::now();
+		fn();
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		ms.push_back(seconds * 1e3);
+		total += seconds;
+	}
+
+	std::sort(ms.begin(), ms.end());
+	return ms;
+}
+
+static std::string jsonString(const std::string &s)
+{
+	std::string out = "\"";
+	for (char c : s)
+	{
+		if (c == '"' || c == '\\')
+			out += '\\';
+		out += c;
+	}
+	return out + "\"";
+}
+
+static void writeJSON(std::ostream &out, const std::vector<StageResult> &results, const BenchSettings &settings)
+{
+	char line[512];
+	out << "{\n";
+	out << "  \"threads\": " << JobSystem::global().size() << ",\n";
+#ifdef NDEBUG
+	out << "  \"build\": \"release\",\n";
+#else
+	out << "  \"build\": \"debug\",\n";
+#endif
+	out << "  \"compiler\": " << jsonString(__VERSION__) << ",\n";
+	out << "  \"min_runs\": " << settings.runs << ",\n";
+	out << "  \"results\": [\n";
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		const StageResult &r = results[i];
+		double median = percentile(r.ms, 50);
+		snprintf(line, sizeof(line),
+				 "    {\"model\": %s, \"stage\": %s, \"runs\": %zu, \"median_ms\": %.6f, \"p10_ms\": %.6f, "
+				 "\"p90_ms\": %.6f, \"min_ms\": %.6f, \"max_ms\": %.6f, \"items\": %.0f, \"unit\": %s, \"per_second\": %.1f}%s\n",
+				 jsonString(r.model).c_str(), jsonString(r.stage).c_str(), r.ms.size(), median,
+				 percentile(r.ms, 10), percentile(r.ms, 90), r.ms.front(), r.ms.back(), r.items,
+				 jsonString(r.unit).c_str(), median > 0.0 ? r.items / (median * 1e-3) : 0.0,
+				 i + 1 < results.size() ? "," : "");
+		out << line;
+	}
+	out << "  ]\n}\n";
+}
+
+static void benchModel(const std::string &path, const BenchSettings &settings, std::vector<StageResult> &results)
+{
+	const std::string model = fs::path(path).filename().string();
+	auto add = [&](const char *stage, const char *unit, double items, std::vector<double> ms)
+	{
+		results.push_back({model, stage, unit, items, std::move(ms)});
+		const StageResult &r = results.back();
+		double median = percentile(r.ms, 50);
+		fprintf(stderr, "%-20s %-16s %6zu %11.4f %11.4f %11.4f %14.0f %s/s\n", model.c_str(), stage, r.ms.size(),
+				median, percentile(r.ms, 10), percentile(r.ms, 90), median > 0.0 ? items / (median * 1e-3) : 0.0, unit);
+	};
+
+	std::vector<Vertex> verts;
+	std::vector<Triangle> tris;
+	std::vector<unsigned int> indices;
+	loadOBJ(path, verts, tris, indices);
+	const double triangles = static_cast<double>(tris.size());
+
+	add("obj_parse", "tris", triangles, measure(settings, [&]()
+										  { verts.clear(); tris.clear(); indices.clear(); }, [&]()
+										  { loadOBJ(path, verts, tris, indices); }));
+
+	Mesh mesh(path);
+	mesh.setPlacement(Placement::Optimal);
+	const double vertices = mesh.NumVerts();
+
+	add("quadrics", "tris", triangles, measure(settings, []() {}, [&]()
+											   { mesh.computeInitialQuadrics(); }));
+	add("collapse_queue", "verts", vertices, measure(settings, []() {}, [&]()
+													 { mesh.initCollapseQueue(); }));
+
+	pMesh pm(mesh);
+	const double collapses = pm.HistorySize();
+	add("initialize", "collapses", collapses, measure(settings, []() {}, [&]()
+													  { pm.Initialize(); }));
+
+	add("update_down", "collapses", collapses, measure(settings, [&]()
+													   { pm.Update(pm.MaxVerts()); }, [&]()
+													   { pm.Update(pm.MinVerts()); }));
+	add("update_up", "splits", collapses, measure(settings, [&]()
+												  { pm.Update(pm.MinVerts()); }, [&]()
+												  { pm.Update(pm.MaxVerts()); }));
+
+	// the same random targets every sample, from wherever the last one ended
+	const int kSeeks = 256;
+	std::vector<int> targets(kSeeks);
+	std::mt19937 rng(1);
+	for (int &t : targets)
+		t = static_cast<int>(rng() % (pm.HistorySize() + 1));
+	add("seek", "seeks", kSeeks, measure(settings, []() {}, [&]()
+										 {
+											 for (int t : targets)
+												 pm.UpdateToStep(t); }));
+
+	// a copy at the halfway LOD, so the rebuild has live and dead triangles
+	pm.UpdateToStep(pm.HistorySize() / 2);
+	Mesh half(pm.Current());
+	add("index_rebuild", "tris", triangles, measure(settings, []() {}, [&]()
+													{ half.updateIndices(); }));
+}
+
+int main(int argc, char *argv[])
+{
+	std::vector<std::string> files;
+	BenchSettings settings;
+	std::string jsonPath;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		if (arg == "--runs" && i + 1 < argc)
+			settings.runs = std::max(1, std::stoi(argv[++i]));
+		else if (arg == "--min-time" && i + 1 < argc)
+			settings.minTime = std::max(0.0, std::stod(argv[++i]));
+		else if (arg == "--json" && i + 1 < argc)
+			jsonPath = argv[++i];
+		else
+			files.push_back(arg);
+	}
+
+	if (files.empty())
+	{
+		std::error_code error;
+		for (const auto &entry : fs::directory_iterator("data/models", error))
+			if (entry.path().extension() == ".obj")
+				files.push_back(entry.path().string());
+		std::sort(files.begin(), files.end(), [](const std::string &a, const std::string &b)
+				  { return fs::file_size(a) < fs::file_size(b); });
+	}
+	if (files.empty())
+	{
+		fprintf(stderr, "no models found, run from the repo root or pass model paths\n");
+		return 1;
+	}
+
+	fprintf(stderr, "%-20s %-16s %6s %11s %11s %11s %14s\n", "model", "stage", "runs", "median ms", "p10 ms", "p90 ms", "throughput");
+
+	// the loaders report to std::cout, keep it for the JSON
+	std::ostringstream sink;
+	auto *old = std::cout.rdbuf(sink.rdbuf());
+
+	std::vector<StageResult> results;
+	for (const auto &path : files)
+	{
+		if (!fs::exists(path))
+		{
+			std::cerr << "missing input: " << path << "\n";
+			continue;
+		}
+		benchModel(path, settings, results);
+	}
+
+	std::cout.rdbuf(old);
+
+	if (jsonPath == "-")
+		writeJSON(std::cout, results, settings);
+	else if (!jsonPath.empty())
+	{
+		std::ofstream out(jsonPath);
+		writeJSON(out, results, settings);
+		if (!out)
+		{
+			std::cerr << "could not write " << jsonPath << "\n";
+			return 1;
+		}
+	}
+
+	return results.empty() ? 1 : 0;
+}
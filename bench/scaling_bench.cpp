@@ -0,0 +1,275 @@
+#include <stdio.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <functional>
+
+#ifdef __linux__
+#include <malloc.h>
+#endif
+
+#include "core/JobSystem.h"
+#include "mesh/Mesh.h"
+#include "mesh/meshGen.h"
+#include "mesh/pMesh.h"
+
+/*
+	pm_scaling
+	Sweeps the simplifier over generated meshes (mesh/meshGen.h) of growing
+	size and records wall time and peak resident memory for each stage:
+	generate, prepare (adjacency, quadrics, queue), simplify (the whole
+	collapse history) and replay (UpdateToStep to the base and back).
+
+	Per shape and stage it fits the exponent of time against triangle count
+	over the sweep. It fails when an exponent or the peak bytes per triangle
+	goes over its limit, so a quadratic neighbour loop or a leaking queue
+	shows up as a failure instead of a slow day. A stage with fewer than
+	two sizes over 5 ms has no exponent ("n/a") and fails too.
+
+		pm_scaling [--min tris] [--max tris] [--steps n] [--repeat n]
+		           [--shapes sphere,terrain,spokes,fan] [--batch w]
+		           [--max-exponent e] [--max-bytes-per-tri b] [--json file|-]
+
+	Sizes run from --min to --max in --steps per decade, 1e4 to 1e6 by
+	default; 1e8 needs tens of GB. Each size runs --repeat times and keeps
+	the fastest time and the largest peak. Peak memory is per stage on
+	Linux, where the high-water mark can be reset, and since start
+	elsewhere.
+*/
+
+struct StageSample
+{
+	std::string shape;
+	std::string stage;
+	uint64_t triangles = 0;
+	double seconds = 0.0;
+	double peakMB = 0.0;  // during the stage
+	double startMB = 0.0; // resident when it began
+};
+
+static double residentMB(const char *field)
+{
+#ifdef __linux__
+	std::ifstream status("/proc/self/status");
+	std::string line;
+	size_t length = std::char_traits<char>::length(field);
+	while (std::getline(status, line))
+		if (line.compare(0, length, field) == 0)
+			return std::stod(line.substr(length + 1)) / 1024.0; // kB
+#else
+	(void)field;
+#endif
+	return 0.0;
+}
+
+// the peak so far becomes the current size, so the next read is per stage
+static void resetPeak()
+{
+#ifdef __linux__
+	malloc_trim(0);
+	std::ofstream("/proc/self/clear_refs") << "5";
+#endif
+}
+
+static StageSample runStage(const char *shape, const char *stage, uint64_t triangles, const std::function<void()> &fn)
+{
+	StageSample s;
+	s.shape = shape;
+	s.stage = stage;
+	s.triangles = triangles;
+
+	resetPeak();
+	s.startMB = residentMB("VmRSS:");
+	auto start = std::chrono::steady_clock::now();
+	fn();
+	s.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	s.peakMB = residentMB("VmHWM:");
+
+	fprintf(stderr, "%-8s %-9s %12llu %11.3f %10.1f %10.1f\n", shape, stage, (unsigned long long)triangles,
+			s.seconds * 1e3, s.startMB, s.peakMB);
+	return s;
+}
+
+// least squares slope of log(seconds) over log(triangles), NaN without two
+// sizes to fit
+static double fitExponent(const std::vector<const StageSample *> &samples)
+{
+	double n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+	for (const StageSample *s : samples)
+	{
+		double x = std::log(static_cast<double>(s->triangles)), y = std::log(std::max(s->seconds, 1e-9));
+		n += 1;
+		sx += x;
+		sy += y;
+		sxx += x * x;
+		sxy += x * y;
+	}
+	double d = n * sxx - sx * sx;
+	return n < 2 || d <= 0.0 ? std::nan("") : (n * sxy - sx * sy) / d;
+}
+
+int main(int argc, char *argv[])
+{
+	double minTris = 1e4, maxTris = 1e6;
+	int steps = 2;
+	std::vector<GenShape> shapes{GenShape::Sphere, GenShape::Terrain, GenShape::Spokes, GenShape::Fan};
+	SimplifyOptions options;
+	double maxExponent = 1.5;
+	int repeats = 3;
+	double maxBytesPerTri = 1024.0;
+	std::string jsonPath;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		if (arg == "--min" && i + 1 < argc)
+			minTris = std::max(100.0, std::stod(argv[++i]));
+		else if (arg == "--max" && i + 1 < argc)
+			maxTris = std::stod(argv[++i]);
+		else if (arg == "--steps" && i + 1 < argc)
+			steps = std::max(1, std::stoi(argv[++i]));
+		else if (arg == "--repeat" && i + 1 < argc)
+			repeats = std::max(1, std::stoi(argv[++i]));
+		else if (arg == "--batch" && i + 1 < argc)
+			options.batchWindow = std::stof(argv[++i]);
+		else if (arg == "--max-exponent" && i + 1 < argc)
+			maxExponent = std::stod(argv[++i]);
+		else if (arg == "--max-bytes-per-tri" && i + 1 < argc)
+			maxBytesPerTri = std::stod(argv[++i]);
+		else if (arg == "--json" && i + 1 < argc)
+			jsonPath = argv[++i];
+		else if (arg == "--shapes" && i + 1 < argc)
+		{
+			shapes.clear();
+			std::stringstream list(argv[++i]);
+			std::string name;
+			while (std::getline(list, name, ','))
+				for (GenShape s : {GenShape::Sphere, GenShape::Terrain, GenShape::Spokes, GenShape::Fan})
+					if (name == genShapeName(s))
+						shapes.push_back(s);
+		}
+		else
+		{
+			std::cerr << "unknown argument: " << arg << "\n";
+			return 1;
+		}
+	}
+
+	std::vector<uint64_t> sizes;
+	for (double t = minTris; t <= maxTris * 1.0001; t *= std::pow(10.0, 1.0 / steps))
+		sizes.push_back(static_cast<uint64_t>(std::llround(t)));
+
+	// what the process holds before any mesh, left out of bytes per triangle
+	resetPeak();
+	const double baselineMB = residentMB("VmRSS:");
+
+	fprintf(stderr, "%-8s %-9s %12s %11s %10s %10s\n", "shape", "stage", "triangles", "ms", "start MB", "peak MB");
+
+	std::vector<StageSample> samples;
+	for (GenShape shape : shapes)
+	{
+		const char *name = genShapeName(shape);
+		for (uint64_t target : sizes)
+		{
+			const size_t first = samples.size();
+			for (int r = 0; r < repeats; ++r)
+			{
+				std::unique_ptr<Mesh> mesh;
+				std::unique_ptr<pMesh> pm;
+				uint64_t triangles = 0;
+
+				StageSample stages[4];
+				stages[0] = runStage(name, "generate", target, [&]()
+									 { mesh = std::make_unique<Mesh>(generateMesh(shape, target));
+									   triangles = mesh->getTriangles().size(); });
+				stages[0].triangles = triangles;
+				stages[1] = runStage(name, "prepare", triangles, [&]()
+									 { mesh->ensureSimplification(); });
+				stages[2] = runStage(name, "simplify", triangles, [&]()
+									 { pm = std::make_unique<pMesh>(*mesh, options); });
+				stages[3] = runStage(name, "replay", triangles, [&]()
+									 {
+										 pm->UpdateToStep(pm->HistorySize());
+										 pm->UpdateToStep(0); });
+
+				for (int k = 0; k < 4; ++k)
+				{
+					if (r == 0)
+						samples.push_back(stages[k]);
+					StageSample &kept = samples[first + k];
+					kept.seconds = std::min(kept.seconds, stages[k].seconds);
+					kept.peakMB = std::max(kept.peakMB, stages[k].peakMB);
+				}
+			}
+		}
+	}
+
+	// fits and limits, over sizes that took long enough to time
+	bool ok = true;
+	std::ostringstream fits;
+	fprintf(stderr, "\n%-8s %-9s %9s %12s\n", "shape", "stage", "exponent", "peak B/tri");
+	bool firstFit = true;
+	for (GenShape shape : shapes)
+		for (const char *stage : {"generate", "prepare", "simplify", "replay"})
+		{
+			std::vector<const StageSample *> timed;
+			double bytesPerTri = 0.0;
+			for (const StageSample &s : samples)
+				if (s.shape == genShapeName(shape) && s.stage == stage)
+				{
+					if (s.seconds >= 5e-3)
+						timed.push_back(&s);
+					// sizes ascend, so this ends on the largest
+					bytesPerTri = (s.peakMB - baselineMB) * 1048576.0 / std::max<uint64_t>(s.triangles, 1);
+				}
+
+			// too few sizes to time is no evidence either way, so not a pass
+			double exponent = fitExponent(timed);
+			bool fitted = !std::isnan(exponent);
+			bool pass = fitted && exponent <= maxExponent && bytesPerTri <= maxBytesPerTri;
+			ok &= pass;
+
+			char value[32];
+			snprintf(value, sizeof(value), fitted ? "%.2f" : "n/a", exponent);
+			fprintf(stderr, "%-8s %-9s %9s %12.0f %s\n", genShapeName(shape), stage, value, bytesPerTri,
+					pass ? "" : fitted ? "FAIL" : "FAIL (fewer than two sizes over 5 ms)");
+
+			snprintf(value, sizeof(value), fitted ? "%.4f" : "null", exponent);
+			char line[256];
+			snprintf(line, sizeof(line), "%s    {\"shape\": \"%s\", \"stage\": \"%s\", \"exponent\": %s, \"peak_bytes_per_tri\": %.1f, \"pass\": %s}",
+					 firstFit ? "" : ",\n", genShapeName(shape), stage, value, bytesPerTri, pass ? "true" : "false");
+			fits << line;
+			firstFit = false;
+		}
+
+	if (!jsonPath.empty())
+	{
+		std::ofstream file;
+		if (jsonPath != "-")
+			file.open(jsonPath);
+		std::ostream &out = jsonPath == "-" ? std::cout : file;
+
+		out << "{\n  \"threads\": " << JobSystem::global().size() << ",\n";
+		out << "  \"batch_window\": " << options.batchWindow << ",\n";
+		out << "  \"repeats\": " << repeats << ",\n";
+		out << "  \"samples\": [\n";
+		for (size_t i = 0; i < samples.size(); ++i)
+		{
+			const StageSample &s = samples[i];
+			char line[256];
+			snprintf(line, sizeof(line), "    {\"shape\": \"%s\", \"stage\": \"%s\", \"triangles\": %llu, \"seconds\": %.6f, \"start_mb\": %.1f, \"peak_mb\": %.1f}%s\n",
+					 s.shape.c_str(), s.stage.c_str(), (unsigned long long)s.triangles, s.seconds, s.startMB, s.peakMB,
+					 i + 1 < samples.size() ? "," : "");
+			out << line;
+		}
+		out << "  ],\n  \"fits\": [\n" << fits.str() << "\n  ],\n";
+		out << "  \"pass\": " << (ok ? "true" : "false") << "\n}\n";
+	}
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <filesystem>
+
+#include "mesh/Mesh.h"
+#include "mesh/pMesh.h"
+#include "mesh/objLoader.h"
+#include "mesh/meshWeld.h"
+
+namespace fs = std::filesystem;
+
+/*
+	pm_seamcheck
+	Checks that simplifying with split seams keeps them closed.
+
+		pm_seamcheck [-n checks] [-b window] [models...]
+
+	Each model is loaded with one vertex per position, normal and uv
+	(pmsimplify --seams) and simplified all the way down, greedily or in
+	rounds of the given window (pmsimplify --batch). The wedges of a point
+	collapse as consecutive history records, so the mesh is looked at
+	where such a group ends, at up to `checks` evenly spaced ones. Welded by
+	position, it must then have no zero-area triangles and no more border
+	edges than at the previous check: a collapse never lengthens a border,
+	so a new one is a seam that opened. Once the last few triangles fold
+	onto each other (an edge with three) that no longer holds, and only the
+	zero-area test is kept. It prints how far each model got and exits 1 on
+	any failure.
+*/
+
+// position-welded edges used by one triangle and by more than two, and
+// triangles with two corners at one point
+static void weldedBorder(const Mesh &mesh, const std::vector<uint32_t> &point, size_t &border, size_t &folded,
+						 size_t &pinched)
+{
+	const std::vector<unsigned int> &indices = mesh.getIndices();
+	std::unordered_map<uint64_t, int> edges;
+	border = folded = pinched = 0;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		uint32_t p[3] = {point[indices[i]], point[indices[i + 1]], point[indices[i + 2]]};
+		if (p[0] == p[1] || p[1] == p[2] || p[0] == p[2])
+		{
+			++pinched;
+			continue;
+		}
+		for (int k = 0; k < 3; ++k)
+		{
+			uint32_t a = std::min(p[k], p[(k + 1) % 3]), b = std::max(p[k], p[(k + 1) % 3]);
+			++edges[(uint64_t(a) << 32) | b];
+		}
+	}
+	for (const auto &edge : edges)
+	{
+		border += edge.second == 1 ? 1 : 0;
+		folded += edge.second > 2 ? 1 : 0;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	std::vector<std::string> files;
+	int maxChecks = 500;
+	SimplifyOptions options;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		if (arg == "-n" && i + 1 < argc)
+			maxChecks = std::max(1, std::stoi(argv[++i]));
+		else if (arg == "-b" && i + 1 < argc)
+			options.batchWindow = std::stof(argv[++i]);
+		else
+			files.push_back(arg);
+	}
+
+	if (files.empty())
+	{
+		std::error_code error;
+		for (const auto &entry : fs::directory_iterator("data/models", error))
+			if (entry.path().extension() == ".obj")
+				files.push_back(entry.path().string());
+	}
+	if (files.empty())
+	{
+		fprintf(stderr, "no models found, run from the repo root or pass model paths\n");
+		return 1;
+	}
+	std::sort(files.begin(), files.end());
+
+	printf("%-16s %8s %8s %8s %8s %7s %9s\n", "model", "verts", "points", "lowest", "border", "checks", "failures");
+
+	bool ok = true;
+	ObjLoadOptions load;
+	load.splitSeams = true;
+	for (const auto &path : files)
+	{
+		Mesh mesh(path, load);
+		// half-edge collapses, so positions never move and the points stay put
+		std::vector<uint32_t> point = weldPositions(mesh.getPositions(), 0.0f);
+		size_t points = 0;
+		for (size_t v = 0; v < point.size(); ++v)
+			points += point[v] == v ? 1 : 0;
+
+		pMesh pm(mesh, options);
+		const std::vector<pVert> &history = pm.History();
+
+		// steps that end a point's group of records
+		std::vector<int> ends;
+		for (size_t s = 1; s <= history.size(); ++s)
+			if (s == history.size() || point[history[s].from] != point[history[s - 1].from])
+				ends.push_back(static_cast<int>(s));
+
+		size_t border, folded, pinched;
+		weldedBorder(pm.Current(), point, border, folded, pinched);
+		size_t startBorder = border;
+		int checks = 0, failures = pinched > 0 ? 1 : 0;
+		size_t count = std::min(ends.size(), static_cast<size_t>(maxChecks));
+		for (size_t i = 0; i < count; ++i)
+		{
+			// spread over the history, ending at its last step
+			pm.UpdateToStep(ends[(i + 1) * ends.size() / count - 1]);
+			size_t before = border;
+			bool manifold = folded == 0;
+			weldedBorder(pm.Current(), point, border, folded, pinched);
+			++checks;
+			if (pinched > 0 || (manifold && border > before))
+				++failures;
+		}
+
+		printf("%-16s %8d %8zu %8d %4zu->%-3zu %7d %9d\n", fs::path(path).filename().string().c_str(), pm.MaxVerts(),
+			   points, pm.MaxVerts() - pm.HistorySize(), startBorder, border, checks, failures);
+		ok &= failures == 0;
+	}
+
+	printf("%s\n", ok ? "ok" : "SEAM OPENED");
+	return ok ? 0 : 1;
+}
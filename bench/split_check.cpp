@@ -0,0 +1,212 @@
+#include <stdio.h>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <filesystem>
+
+#include "mesh/Mesh.h"
+#include "mesh/pMesh.h"
+#include "mesh/objLoader.h"
+
+namespace fs = std::filesystem;
+
+/*
+	pm_splitcheck
+	Checks that Mesh::vertexSplit undoes Mesh::edgeCollapse exactly.
+
+		pm_splitcheck [-w walks] [-k max collapses] [--seams] [models...]
+
+	Per model and placement it walks down the greedy collapse order until
+	the mesh is used up (or for `walks` steps): snapshot the mesh (a copy,
+	every array shared until written), collapse up to `max collapses`
+	cheapest candidates, split them all back from their records and
+	compare the whole simplification state with the snapshot: liveness,
+	positions, quadrics and destinies bit for bit, triangles, each
+	vertex's incident triangles, the class of every edge and the collapse
+	queue popped in order. Collapsing again must then pick the same
+	collapses as the first time, and the walk goes on from there. --seams
+	loads the models as pmsimplify --seams does, so seam wedges collapse
+	together. Exits 1 on any difference.
+*/
+
+// collapses the cheapest candidate and its seam siblings, as the greedy
+// simplifier does; false once nothing is left to collapse
+static bool collapseNext(Mesh &mesh, std::vector<CollapseRecord> &records, std::vector<pFace> &log,
+						 std::vector<VertexCost> &siblings)
+{
+	if (mesh.NumVerts() <= 3)
+		return false;
+	VertexID u = mesh.cheapestVertex();
+	if (u < 0)
+		return false;
+
+	VertexID v = mesh.getDestiny(u);
+	mesh.seamSiblings(u, v, siblings);
+	records.push_back(mesh.edgeCollapse(u, v, &log));
+	for (const VertexCost &s : siblings)
+		records.push_back(mesh.edgeCollapse(s.u, s.v, &log));
+	return true;
+}
+
+// every queued entry, cheapest first
+static std::vector<VertexCost> queueOrder(const Mesh &mesh)
+{
+	CollapseHeap queue = mesh.getCollapseQueue();
+	std::vector<VertexCost> order;
+	while (!queue.empty())
+		order.push_back(queue.pop());
+	return order;
+}
+
+// the first difference between the two meshes' simplification state, or
+// nullptr when there is none
+static const char *difference(const Mesh &a, const Mesh &b)
+{
+	if (a.TotalVerts() != b.TotalVerts() || a.NumVerts() != b.NumVerts())
+		return "vertex count";
+
+	std::vector<TriangleID> ta, tb;
+	for (VertexID u = 0; u < a.TotalVerts(); ++u)
+	{
+		if (a.isAlive(u) != b.isAlive(u))
+			return "liveness";
+		if (std::memcmp(&a.getPositions()[u], &b.getPositions()[u], sizeof(glm::vec3)) != 0)
+			return "position";
+		if (std::memcmp(&a.getQuadric(u), &b.getQuadric(u), sizeof(Quadric)) != 0)
+			return "quadric";
+		if (a.isAlive(u) && a.getDestiny(u) != b.getDestiny(u))
+			return "destiny";
+
+		// slices keep no order
+		auto ra = a.getIncidence()[u], rb = b.getIncidence()[u];
+		ta.assign(ra.begin(), ra.end());
+		tb.assign(rb.begin(), rb.end());
+		std::sort(ta.begin(), ta.end());
+		std::sort(tb.begin(), tb.end());
+		if (ta != tb)
+			return "incidence";
+	}
+
+	const std::vector<Triangle> &tris = a.getTriangles();
+	for (size_t i = 0; i < tris.size(); ++i)
+	{
+		if (tris[i].verts != b.getTriangles()[i].verts)
+			return "triangle";
+		for (int k = 0; k < 3; ++k)
+		{
+			VertexID p = tris[i].verts[k], q = tris[i].verts[(k + 1) % 3];
+			if (p != q && a.classifyEdge(p, q) != b.classifyEdge(p, q))
+				return "edge class";
+		}
+	}
+
+	std::vector<VertexCost> qa = queueOrder(a), qb = queueOrder(b);
+	if (qa.size() != qb.size())
+		return "queue size";
+	for (size_t i = 0; i < qa.size(); ++i)
+		if (qa[i].u != qb[i].u || qa[i].v != qb[i].v || std::memcmp(&qa[i].cost, &qb[i].cost, sizeof(float)) != 0)
+			return "queue order";
+
+	return nullptr;
+}
+
+int main(int argc, char *argv[])
+{
+	std::vector<std::string> files;
+	int walks = 0;
+	int maxRun = 64;
+	ObjLoadOptions load;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		if (arg == "-w" && i + 1 < argc)
+			walks = std::max(0, std::stoi(argv[++i]));
+		else if (arg == "-k" && i + 1 < argc)
+			maxRun = std::max(1, std::stoi(argv[++i]));
+		else if (arg == "--seams")
+			load.splitSeams = true;
+		else
+			files.push_back(arg);
+	}
+
+	if (files.empty())
+	{
+		std::error_code error;
+		for (const auto &entry : fs::directory_iterator("data/models", error))
+			if (entry.path().extension() == ".obj")
+				files.push_back(entry.path().string());
+	}
+	if (files.empty())
+	{
+		fprintf(stderr, "no models found, run from the repo root or pass model paths\n");
+		return 1;
+	}
+	std::sort(files.begin(), files.end());
+
+	printf("%-16s %-9s %7s %10s %10s %9s\n", "model", "placement", "walks", "collapses", "splits", "failures");
+
+	bool ok = true;
+	for (const auto &path : files)
+	{
+		std::string name = fs::path(path).filename().string();
+		Mesh loaded(path, load);
+		for (Placement placement : {Placement::Endpoint, Placement::Optimal})
+		{
+			Mesh mesh(loaded);
+			mesh.setPlacement(placement);
+			mesh.ensureSimplification();
+
+			std::mt19937 rng(1);
+			std::vector<CollapseRecord> records;
+			std::vector<pFace> log;
+			std::vector<VertexCost> siblings;
+
+			int done = 0, collapses = 0, splits = 0, failures = 0;
+			for (; walks == 0 || done < walks; ++done)
+			{
+				Mesh snapshot(mesh);
+				size_t depth = records.size();
+
+				int run = 1 + static_cast<int>(rng() % maxRun), steps = 0;
+				while (steps < run && collapseNext(mesh, records, log, siblings))
+					++steps;
+				if (steps == 0)
+					break;
+				std::vector<CollapseRecord> first(records.begin() + depth, records.end());
+				collapses += static_cast<int>(first.size());
+
+				// back to the snapshot, latest collapse first
+				while (records.size() > depth)
+				{
+					mesh.vertexSplit(records.back(), log);
+					log.resize(records.back().facesBegin);
+					records.pop_back();
+					++splits;
+				}
+				const char *diff = difference(mesh, snapshot);
+
+				// and down again, the same way
+				for (int i = 0; i < steps; ++i)
+					collapseNext(mesh, records, log, siblings);
+				bool same = records.size() - depth == first.size();
+				for (size_t i = 0; same && i < first.size(); ++i)
+					same = records[depth + i].u == first[i].u && records[depth + i].v == first[i].v;
+				if (!diff && !same)
+					diff = "the next collapses";
+
+				if (diff && failures++ == 0)
+					printf("  %s, walk %d: %s differ after splitting back\n", name.c_str(), done, diff);
+			}
+
+			printf("%-16s %-9s %7d %10d %10d %9d\n", name.c_str(),
+				   placement == Placement::Optimal ? "optimal" : "endpoint", done, collapses, splits, failures);
+			ok &= failures == 0;
+		}
+	}
+
+	printf("%s\n", ok ? "ok" : "MISMATCH");
+	return ok ? 0 : 1;
+}
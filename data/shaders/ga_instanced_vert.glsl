@@ -0,0 +1,11 @@
+#version 330 core
+
+uniform mat4 u_viewProj;
+
+layout(location = 0) in vec3 in_vertex;
+layout(location = 3) in mat4 in_model;
+
+void main()
+{
+    gl_Position = u_viewProj * in_model * vec4(in_vertex, 1.0);
+}
@@ -0,0 +1,125 @@
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//===========================================================================JOB COUNTER
+// Counts outstanding jobs; JobSystem::wait() returns once it reaches zero.
+struct JobCounter
+{
+	std::atomic<int> count{0};
+};
+
+//===========================================================================JOB SYSTEM
+// Small work-stealing thread pool. Every worker owns a deque: it pushes and
+// pops its own jobs at the back and, when it runs dry, steals from the front
+// of the others. Threads that are not workers submit into a shared queue.
+// A thread waiting on a counter runs jobs itself instead of blocking, so
+// jobs may submit and wait on further jobs.
+class JobSystem
+{
+public:
+	using Job = std::function<void()>;
+
+	// workers = 0 still works, waiting threads then run every job themselves
+	explicit JobSystem(unsigned workers);
+	JobSystem(const JobSystem &) = delete;
+	JobSystem &operator=(const JobSystem &) = delete;
+	~JobSystem();
+
+	// process-wide pool, one thread per core including the caller. The
+	// PM_THREADS environment variable overrides the count
+	static JobSystem &global();
+
+	// threads that take part in running jobs: the workers plus the caller
+	unsigned size() const { return static_cast<unsigned>(threads.size()) + 1; }
+
+	void submit(JobCounter &counter, Job job);
+	// runs queued jobs until counter drops to zero
+	void wait(JobCounter &counter);
+
+	// fn(first, last) over [begin, end) split into pieces of at least grain
+	// items. Each index is visited exactly once; which thread runs a piece
+	// is not fixed, so fn must only write per-index results
+	template <typename Fn>
+	void parallelFor(size_t begin, size_t end, size_t grain, Fn &&fn)
+	{
+		if (end <= begin)
+			return;
+
+		size_t count = end - begin;
+		size_t pieces = std::min<size_t>(size() * 4, (count + grain - 1) / std::max<size_t>(grain, 1));
+		if (pieces <= 1)
+		{
+			fn(begin, end);
+			return;
+		}
+
+		JobCounter counter;
+		for (size_t p = 0; p < pieces; ++p)
+		{
+			size_t first = begin + count * p / pieces;
+			size_t last = begin + count * (p + 1) / pieces;
+			submit(counter, [&fn, first, last]()
+				   { fn(first, last); });
+		}
+		wait(counter);
+	}
+
+private:
+	struct Queue
+	{
+		std::mutex lock;
+		std::deque<Job> jobs;
+	};
+
+	bool runOne(int self);
+	void workerLoop(int index);
+
+	// queues[i] belongs to worker i, the last one is shared by outside threads
+	std::vector<std::unique_ptr<Queue>> queues;
+	std::vector<std::thread> threads;
+
+	std::mutex sleepLock;
+	std::condition_variable wake;
+	std::atomic<int> queued{0};
+	bool stopping = false;
+};
+
+//===========================================================================TASK GRAPH
+// Tasks with dependencies, run on a JobSystem. A task starts once every task
+// that precedes it has finished; run() returns when all of them are done.
+class TaskGraph
+{
+public:
+	using TaskID = int;
+
+	TaskID add(std::function<void()> fn);
+	// `after` waits for `before`
+	void precede(TaskID before, TaskID after);
+
+	void run(JobSystem &jobs);
+
+private:
+	struct Node
+	{
+		std::function<void()> fn;
+		std::vector<TaskID> next;
+		int dependencies = 0;
+		std::atomic<int> remaining{0};
+	};
+
+	void launch(JobSystem &jobs, JobCounter &counter, TaskID id);
+
+	std::vector<std::unique_ptr<Node>> nodes;
+};
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef SHARED_H
+#define SHARED_H
+
+#include <atomic>
+#include <memory>
+#include <utility>
+
+//===========================================================================SHARED
+// Copy-on-write value. Copies share one T until one of them asks to write,
+// which gives that copy its own T first. Reading is a pointer dereference.
+//
+// write() on copies held by different threads is safe; write() on the same
+// object from several threads is not, call it once before going parallel.
+template <typename T>
+class Shared
+{
+public:
+	Shared() : data(std::make_shared<T>()) {}
+	explicit Shared(T value) : data(std::make_shared<T>(std::move(value))) {}
+
+	const T &operator*() const { return *data; }
+	const T *operator->() const { return data.get(); }
+
+	template <typename I>
+	decltype(auto) operator[](I i) const { return (*data)[i]; }
+
+	T &write()
+	{
+		if (data.use_count() > 1)
+			data = std::make_shared<T>(*data);
+		else
+			// pairs with the release in the other copy's reference drop, so its
+			// last reads happen before our writes
+			std::atomic_thread_fence(std::memory_order_acquire);
+		return *data;
+	}
+
+	// another copy still refers to the same T
+	bool isShared() const { return data.use_count() > 1; }
+
+private:
+	std::shared_ptr<T> data;
+};
+
+#endif
@@ -0,0 +1,133 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+// counted events, summed over every thread
+enum class Stat
+{
+	Collapses,		 // edge collapses while simplifying
+	CostEvaluations, // Cost() calls
+	StalePops,		 // queue entries popped and thrown away
+	ReplaySteps,	 // recorded collapses and splits played back
+	BytesUploaded,	 // to GL buffers
+	Uploads,		 // GL buffer writes
+	Count
+};
+
+// the largest value seen
+enum class StatPeak
+{
+	QueueSize, // entries in one collapse queue
+	Count
+};
+
+// time spent inside a StatScope, and how many times one ran
+enum class StatTimer
+{
+	Prepare,	 // adjacency, quadrics and the collapse queue
+	Simplify,	 // the collapse loop of pMesh::Initialize
+	Replay,		 // Update / UpdateToStep
+	IndexUpdate, // Mesh::updateIndices, full and incremental
+	Upload,		 // MeshRenderer uploads
+	Count
+};
+
+//===========================================================================STATS
+// Process-wide counters and timers for the simplifier and the renderer.
+// Each thread adds into its own block with plain relaxed stores, so there
+// is no contended cache line; statsSnapshot() sums the blocks. Hot loops
+// count locally and add once per call rather than once per event.
+//
+// Configuring with PM_ENABLE_STATS=OFF defines PM_NO_STATS, which turns
+// every call here except the snapshot into nothing.
+struct StatsSnapshot
+{
+	uint64_t counts[static_cast<int>(Stat::Count)] = {};
+	uint64_t peaks[static_cast<int>(StatPeak::Count)] = {};
+	double seconds[static_cast<int>(StatTimer::Count)] = {};
+	uint64_t calls[static_cast<int>(StatTimer::Count)] = {};
+
+	uint64_t operator[](Stat s) const { return counts[static_cast<int>(s)]; }
+	uint64_t operator[](StatPeak p) const { return peaks[static_cast<int>(p)]; }
+	double operator[](StatTimer t) const { return seconds[static_cast<int>(t)]; }
+
+	// simplifier collapses per second of Simplify time
+	double collapsesPerSecond() const;
+};
+
+struct StatBlock
+{
+	std::atomic<uint64_t> counts[static_cast<int>(Stat::Count)] = {};
+	std::atomic<uint64_t> nanoseconds[static_cast<int>(StatTimer::Count)] = {};
+	std::atomic<uint64_t> calls[static_cast<int>(StatTimer::Count)] = {};
+};
+
+// the calling thread's block, registered on first use
+StatBlock &statBlock();
+void statPeak(StatPeak p, uint64_t value);
+
+inline void statAdd(Stat s, uint64_t n = 1)
+{
+#ifndef PM_NO_STATS
+	// only this thread writes the block, no read-modify-write needed
+	std::atomic<uint64_t> &c = statBlock().counts[static_cast<int>(s)];
+	c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+#else
+	(void)s;
+	(void)n;
+#endif
+}
+
+// times its own lifetime into a StatTimer
+class StatScope
+{
+public:
+	explicit StatScope(StatTimer t)
+#ifndef PM_NO_STATS
+		: timer(t), start(std::chrono::steady_clock::now())
+#endif
+	{
+		(void)t;
+	}
+
+	~StatScope()
+	{
+#ifndef PM_NO_STATS
+		auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+		StatBlock &b = statBlock();
+		std::atomic<uint64_t> &total = b.nanoseconds[static_cast<int>(timer)];
+		std::atomic<uint64_t> &count = b.calls[static_cast<int>(timer)];
+		total.store(total.load(std::memory_order_relaxed) + static_cast<uint64_t>(ns), std::memory_order_relaxed);
+		count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+#endif
+	}
+
+	StatScope(const StatScope &) = delete;
+	StatScope &operator=(const StatScope &) = delete;
+
+private:
+#ifndef PM_NO_STATS
+	StatTimer timer;
+	std::chrono::steady_clock::time_point start;
+#endif
+};
+
+// everything since the last statsReset()
+StatsSnapshot statsSnapshot();
+void statsReset();
+// false when built with PM_NO_STATS
+bool statsEnabled();
+
+const char *statName(Stat s);
+const char *statName(StatPeak p);
+const char *statName(StatTimer t);
+
+// one JSON object, counters, peaks and timers by name; `indent` prefixes
+// every line after the first
+void writeStatsJSON(std::ostream &out, const StatsSnapshot &stats, const char *indent = "");
+
+#endif
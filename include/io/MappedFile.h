@@ -0,0 +1,39 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+//===========================================================================MAPPED FILE
+// Read-only memory mapping of a whole file. The mapping lives as long as
+// the object; moving transfers ownership.
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	explicit MappedFile(const std::string &path) { open(path); }
+	MappedFile(MappedFile &&other) noexcept;
+	MappedFile &operator=(MappedFile &&other) noexcept;
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+	~MappedFile() { close(); }
+
+	bool open(const std::string &path);
+	void close();
+
+	bool isOpen() const { return opened; }
+	const char *data() const { return static_cast<const char *>(view); }
+	size_t size() const { return length; }
+
+private:
+	void *view = nullptr;
+	size_t length = 0;
+	bool opened = false;
+
+#ifdef _WIN32
+	void *fileHandle = nullptr;
+	void *mappingHandle = nullptr;
+#endif
+};
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef COLLAPSEHEAP_H
+#define COLLAPSEHEAP_H
+
+#include <cstdint>
+#include <vector>
+
+using VertexID = int;
+
+// cheapest collapse found for u: onto its neighbour v
+struct VertexCost
+{
+	VertexID u; // vertex to collapse
+	VertexID v; // target vertex
+	float cost;
+};
+
+//===========================================================================COLLAPSE HEAP
+// Binary min-heap of collapse candidates, at most one per vertex, that can
+// be addressed by vertex. A cost change moves the vertex's entry in place
+// instead of pushing a duplicate, so the heap never holds stale entries and
+// its size is bounded by the number of live candidates.
+class CollapseHeap
+{
+public:
+	struct Stats
+	{
+		uint64_t inserts = 0;
+		uint64_t updates = 0;
+		uint64_t erases = 0;
+		uint64_t pops = 0;
+		size_t peakSize = 0;
+	};
+
+	// replace the contents with entries (one per vertex) in O(n)
+	void build(std::vector<VertexCost> entries, size_t vertexCount);
+	// insert e.u, or move it to its new cost if it is already queued
+	void update(const VertexCost &e);
+	void erase(VertexID u);
+	void clear();
+
+	bool contains(VertexID u) const { return static_cast<size_t>(u) < slot.size() && slot[u] >= 0; }
+	bool empty() const { return heap.empty(); }
+	size_t size() const { return heap.size(); }
+
+	const VertexCost &top() const { return heap.front(); }
+	VertexCost pop();
+
+	const Stats &stats() const { return counters; }
+	size_t memoryBytes() const { return heap.capacity() * sizeof(VertexCost) + slot.capacity() * sizeof(int32_t); }
+
+private:
+	// cheaper first, ties broken by vertex so the order is reproducible
+	static bool before(const VertexCost &a, const VertexCost &b)
+	{
+		return a.cost < b.cost || (a.cost == b.cost && a.u < b.u);
+	}
+
+	void place(size_t i, const VertexCost &e);
+	void siftUp(size_t i);
+	void siftDown(size_t i);
+	void removeAt(size_t i);
+
+	std::vector<VertexCost> heap;
+	std::vector<int32_t> slot; // heap index of each vertex, -1 when absent
+	Stats counters;
+};
+
+#endif
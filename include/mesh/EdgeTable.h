@@ -0,0 +1,53 @@
+#ifndef EDGETABLE_H
+#define EDGETABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using VertexID = int;
+
+//===========================================================================EDGE TABLE
+// Number of triangles on each undirected edge, in an open addressing hash
+// table keyed by the (smaller, larger) vertex pair. Edges are not removed
+// in place: an edge whose count drops to zero reads as absent until the next
+// rehash leaves it out, so lookups never have to step over tombstones.
+class EdgeTable
+{
+public:
+	// drop everything and size for about `edges` distinct edges
+	void reset(size_t edges);
+
+	// add delta (+1 / -1) to the count of edge (a, b)
+	void add(VertexID a, VertexID b, int delta);
+	uint32_t count(VertexID a, VertexID b) const;
+
+	size_t size() const { return used; }
+	size_t memoryBytes() const { return slots.capacity() * sizeof(Slot); }
+
+private:
+	struct Slot
+	{
+		uint64_t key;
+		uint32_t count;
+	};
+
+	static constexpr uint64_t kEmpty = ~uint64_t(0);
+
+	static uint64_t makeKey(VertexID a, VertexID b)
+	{
+		if (a > b)
+			std::swap(a, b);
+		return (uint64_t(uint32_t(a)) << 32) | uint32_t(b);
+	}
+
+	size_t find(uint64_t key) const;
+	void grow();
+
+	std::vector<Slot> slots;
+	size_t mask = 0;
+	size_t used = 0;
+};
+
+#endif
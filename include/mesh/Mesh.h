@@ -7,15 +7,18 @@
 #include <fstream>
 #include <vector>
 #include <array>
-#include <queue>
-
-#include <glad/glad.h>
-#include <GLFW/glfw3.h>
+#include <cstdint>
+#include <limits>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "core/Shared.h"
+#include "mesh/CollapseHeap.h"
+#include "mesh/EdgeTable.h"
+#include "mesh/Quadric.h"
+
 class Vertex;
 class Triangle;
 class Mesh;
@@ -25,31 +28,13 @@ class Mesh;
 using VertexID = int;
 using TriangleID = int;
 
+// per-vertex attributes, as loaded and saved. The simplification state
+// (quadrics, adjacency, liveness) lives in Mesh's own per-vertex arrays
 struct Vertex
 {
 	glm::vec3 Position{};
 	glm::vec3 Normal{};
 	glm::vec2 TexCoords{};
-
-	glm::mat4 Q; // quadric error matrix
-
-	std::vector<TriangleID> triangles;
-	std::vector<VertexID> neighbors;
-
-	VertexID destiny = -1;
-	bool alive = true;
-};
-
-struct VertexCost
-{
-	VertexID u; // vertex to collapse
-	VertexID v; // target vertex
-	float cost;
-
-	bool operator<(const VertexCost &other) const
-	{
-		return cost > other.cost;
-	}
 };
 
 //===========================================================================EDGE
@@ -90,7 +75,6 @@ struct Triangle
 
 	std::array<VertexID, 3> verts{};
 	std::array<VertexID, 3> originalVerts{};
-	glm::vec3 normal{};
 
 	bool isDegenerate() const
 	{
@@ -111,53 +95,298 @@ struct Triangle
 				v = to;
 	}
 
+	// what an edge collapse from -> to does to this triangle:
+	// triangles on the edge vanish, the rest are renamed
+	void collapse(VertexID from, VertexID to)
+	{
+		if (contains(to))
+			verts = {from, from, from};
+		else
+			replace(from, to);
+	}
+
 	glm::vec3 getNormal(const Mesh &m) const;
 };
 
+// a triangle changed by an edge collapse, with its corners from before the
+// collapse. Re-applying Triangle::collapse to `before` redoes it, writing
+// `before` back undoes it.
+struct pFace
+{
+	TriangleID tri;
+	std::array<VertexID, 3> before;
+};
+
+// everything edgeCollapse changed, enough for vertexSplit to undo it
+// exactly. The renamed triangles are faces[facesBegin, facesBegin +
+// faceCount) of the log the collapse wrote to; incidence and edge counts
+// follow from them: a renamed triangle joined v, a degenerate one left its
+// corners other than u, and u kept its own list.
+struct CollapseRecord
+{
+	VertexID u;
+	VertexID v;
+	uint32_t facesBegin;
+	uint32_t faceCount;
+	glm::vec3 vPosition; // v before the collapse
+	Quadric vQuadric;	 // v's quadric before the collapse
+};
+
+//===========================================================================INCIDENCE
+// Triangles around each vertex, CSR style: one shared array holding a slice
+// per vertex, with a little spare room so collapses can grow a slice in
+// place. A slice that outgrows its room moves to the end of the array and
+// the space it left behind is reclaimed by the next compaction.
+class IncidenceTable
+{
+public:
+	struct Range
+	{
+		const TriangleID *first, *last;
+		const TriangleID *begin() const { return first; }
+		const TriangleID *end() const { return last; }
+		size_t size() const { return last - first; }
+	};
+
+	void build(const std::vector<Triangle> &tris, size_t vertexCount);
+
+	Range operator[](VertexID u) const
+	{
+		const Slice &s = slices[u];
+		return {items.data() + s.begin, items.data() + s.begin + s.count};
+	}
+
+	void add(VertexID u, TriangleID t);
+	// order is not kept, the last entry fills the gap
+	void remove(VertexID u, TriangleID t);
+	// room for `extra` more adds to u without moving its slice, so adds to
+	// different vertices can then run concurrently
+	void reserve(VertexID u, uint32_t extra);
+
+	size_t vertexCount() const { return slices.size(); }
+	size_t memoryBytes() const { return slices.capacity() * sizeof(Slice) + items.capacity() * sizeof(TriangleID); }
+
+private:
+	struct Slice
+	{
+		uint32_t begin;
+		uint32_t count;
+		uint32_t capacity;
+	};
+
+	void relocate(VertexID u, uint32_t minCapacity);
+	void compact();
+
+	std::vector<Slice> slices;
+	std::vector<TriangleID> items;
+	size_t wasted = 0; // entries left behind by moved slices
+};
+
+// how many live triangles share an edge
+enum class EdgeKind
+{
+	None,		// no live triangle uses it
+	Boundary,	// one
+	Interior,	// two
+	NonManifold // more, never collapsed
+};
+
+// where the surviving vertex of an edge collapse ends up
+enum class Placement
+{
+	Endpoint, // half-edge collapse, u moves onto v
+	Optimal	  // v moves to the point minimising the combined quadric
+};
+
+struct ObjLoadOptions;
+
 //===========================================================================MESH
 class Mesh
 {
 public:
 	Mesh();
+	// cheap: every array is shared with other until one of the two changes
+	// it, so a new LOD view of a loaded mesh costs a few reference counts
 	Mesh(const Mesh &other);
 	Mesh(const std::string &path);
+	Mesh(const std::string &path, const ObjLoadOptions &options);
+	// geometry only: no adjacency, quadrics or collapse queue, so the mesh can
+	// be drawn and have recorded collapses replayed on it, but not simplified
+	Mesh(const std::vector<Vertex> &verts, std::vector<Triangle> tris);
 	Mesh &operator=(const Mesh &other);
 	~Mesh();
 
-	void Draw(GLuint programID, const glm::mat4 &MVP);
-	void updateVBO();
+	// rebuild the active index list from the live triangles
+	void updateIndices();
+	// the same, re-checking only the given triangles. Enough after replaying
+	// recorded collapses or splits: their face lists hold every triangle
+	// whose corners or liveness changed
+	void updateIndices(const pFace *changed, size_t count);
 
 	// Progressive mesh ops
-	void edgeCollapse(VertexID u, VertexID v);
-	void vertexSplit(VertexID u, VertexID v);
-
+	// changes, when given, receives every triangle the collapse modified
+	// with Optimal placement v also moves to collapsePosition(u, v).
+	// The record can only be undone if changes was given
+	CollapseRecord edgeCollapse(VertexID u, VertexID v, std::vector<pFace> *changes = nullptr);
+	// undoes the latest collapse not yet undone: geometry, adjacency, edge
+	// counts, quadrics and the queue entries around it, in O(1-ring)
+	void vertexSplit(const CollapseRecord &record, const std::vector<pFace> &changes);
+
+	// changing placement re-prices every candidate collapse
+	void setPlacement(Placement p);
+	// adjacency, quadrics and the collapse queue for a geometry-only mesh,
+	// now rather than on its first simplification call
+	void ensureSimplification();
+	// stages of that set-up, each can be repeated on a mesh that has it and
+	// is not simplified yet: vertex quadrics from the face planes, then
+	// every vertex's cheapest collapse into the queue
+	void computeInitialQuadrics();
+	void initCollapseQueue();
+	Placement getPlacement() const { return placement; }
+	glm::vec3 collapsePosition(VertexID u, VertexID v) const;
+
+	// Attribute seams: live vertices at exactly the same position are wedges
+	// of one surface point, apart because their normals or uvs differ. A
+	// seam vertex only collapses together with all its siblings, each onto a
+	// wedge of the same point, and nothing collapsing onto a seam vertex
+	// moves it, so the seam never opens
+	bool onSeam(VertexID u) const { return !seamNext->empty() && seamNext[u] != u; }
+	bool samePoint(VertexID u, VertexID v) const;
+	// the rest of u's collapse onto v: every other live wedge of u's point,
+	// each onto the wedge of v's point it shares an edge with. A wedge that
+	// touches none of them (a sector away from v) goes onto the one with
+	// the closest normal. Costs are left at 0, out is empty off a seam
+	void seamSiblings(VertexID u, VertexID v, std::vector<VertexCost> &out) const;
+	// a cut between two wedges rather than a border of the surface
+	bool isSeamEdge(VertexID u, VertexID v) const;
+
+	// pops the cheapest candidate, -1 once none are left. A collapse of a
+	// seam vertex must be followed by its seamSiblings'
 	VertexID cheapestVertex();
+	const CollapseHeap::Stats &queueStats() const { return collapseQueue->stats(); }
+	// read-only, for checking the simplification state
+	const CollapseHeap &getCollapseQueue() const { return *collapseQueue; }
+	const IncidenceTable &getIncidence() const { return *vertTriangles; }
+
+	// Batched simplification
+	// pops up to `window` candidates, cheapest first, and keeps the ones whose
+	// endpoints and rings overlap none kept before them, at most maxCollapses.
+	// The rest go back into the queue. window = 1 is the plain greedy order.
+	// A seam collapse comes with its siblings' right after it
+	std::vector<VertexCost> selectIndependentCollapses(size_t window, size_t maxCollapses);
+	// applies a selected batch, the collapses themselves in parallel.
+	// changes[i] receives the triangles batch[i] modified; replaying the
+	// batch one collapse at a time in order gives the same mesh
+	void collapseIndependent(const std::vector<VertexCost> &batch, std::vector<std::vector<pFace>> &changes);
 	int NumVerts() const;
-
-	const std::vector<Vertex>& getVertices() const { return vertices; }
-	std::vector<Vertex> &getVertices() { return vertices; }
-
-	bool isBoundaryEdge(VertexID u, VertexID v) const;
-
-	const std::vector<Triangle> &getTriangles() const { return triangles; }
-	std::vector<Triangle> &getTriangles() { return triangles; }
+	void setAlive(VertexID u, bool alive);
+
+	// all vertices, dead ones included
+	int TotalVerts() const { return static_cast<int>(positions->size()); }
+
+	const std::vector<glm::vec3> &getPositions() const { return *positions; }
+	const std::vector<glm::vec3> &getNormals() const { return *normals; }
+	const std::vector<glm::vec2> &getTexCoords() const { return *texCoords; }
+	Vertex getVertex(VertexID u) const { return {positions[u], normals[u], texCoords[u]}; }
+	void setVertex(VertexID u, const Vertex &v);
+	void setPosition(VertexID u, const glm::vec3 &p) { positions.write()[u] = p; }
+
+	bool isAlive(VertexID u) const { return alive[u] != 0; }
+	VertexID getDestiny(VertexID u) const { return destiny[u]; }
+	const Quadric &getQuadric(VertexID u) const { return quadrics[u]; }
+	// plane (unit normal, offset) of each triangle in its original position
+	const std::vector<glm::vec4> &getFacePlanes() const { return *facePlanes; }
+
+	// O(1), from face counts kept up to date by edgeCollapse / vertexSplit
+	EdgeKind classifyEdge(VertexID u, VertexID v) const;
+	bool isBoundaryEdge(VertexID u, VertexID v) const { return classifyEdge(u, v) == EdgeKind::Boundary; }
+	bool isNonManifoldEdge(VertexID u, VertexID v) const { return classifyEdge(u, v) == EdgeKind::NonManifold; }
+
+	const std::vector<Triangle> &getTriangles() const { return *triangles; }
+	// for writing, unshares the triangles
+	std::vector<Triangle> &getTriangles() { return triangles.write(); }
+
+	const std::vector<unsigned int> &getIndices() const { return *indices; }
+
+	// Index list changes, for uploading only what changed. The list is
+	// packed in slots of 3 indices; every slot write bumps indexVersion().
+	// slots receives the slots written since version `since` (repeats
+	// possible), or false is returned when that is no longer known, after a
+	// full rebuild or once more slots were written than there are
+	uint64_t indexVersion() const { return indexLogBase + indexLog.size(); }
+	bool indexChangesSince(uint64_t since, std::vector<uint32_t> &slots) const;
+
+	// heap bytes of every array this mesh refers to, arrays shared with
+	// other copies included
+	size_t memoryBytes() const;
 
 private:
-	void setupMesh();
-	void destroyGL();
-	void initCollapseQueue();
+	void setAttributes(const std::vector<Vertex> &verts);
+	// adjacency (when asked), face planes, quadrics and the collapse queue
+	void prepareSimplification(bool needAdjacency);
+	void buildAdjacency();
+	// needs the adjacency, vertices without triangles are never on a seam
+	void buildSeams();
+	// seam vertices price against their siblings' edges, re-price those too
+	void addSeamSiblings(std::vector<VertexID> &affected) const;
+	// v, every other wedge of its point and all their rings, onto affected
+	// without repeats: whatever prices a collapse against v's quadric
+	void addPointRings(VertexID v, std::vector<VertexID> &affected) const;
+	// w also shares an edge with another wedge of target's point: the
+	// triangle between them would keep zero area and the seam would open
+	bool pinchesSeam(VertexID w, VertexID target) const;
+	// distinct vertices sharing a live triangle with u
+	void gatherNeighbors(VertexID u, std::vector<VertexID> &out) const;
+	void countEdges(const std::array<VertexID, 3> &verts, int delta);
+	VertexCost bestCollapse(VertexID u, std::vector<VertexID> &ring) const;
 	void updateVertexCost(VertexID u);
-	void computeInitialQuadrics();
-
-	std::priority_queue<VertexCost> collapseQueue;
-	std::vector<float> cachedCosts;
+	void collapseLocal(VertexID u, VertexID v, std::vector<pFace> &changes);
+	uint32_t nextRegionRound();
+	void computeFacePlanes();
+	bool isDrawn(const Triangle &t) const;
+	void logIndexSlot(uint32_t slot);
+
+	// Shared between copies, each copied on its first write. Playback never
+	// writes the simplification state and endpoint placement never writes
+	// positions, so LOD views of one mesh keep a single copy of them; the
+	// LOD arrays at the end are only copied once a view leaves the LOD it
+	// was cloned at
+
+	// vertex data, structure-of-arrays so each pass only touches what it uses
+	Shared<std::vector<glm::vec3>> positions;
+	Shared<std::vector<glm::vec3>> normals;
+	Shared<std::vector<glm::vec2>> texCoords;
+
+	// simplification state
+	Shared<CollapseHeap> collapseQueue;
+	Shared<std::vector<Quadric>> quadrics; // quadric error matrix
+	Shared<IncidenceTable> vertTriangles;
+	Shared<EdgeTable> edgeFaces; // live triangles per edge
+	Shared<std::vector<VertexID>> destiny;
+	Shared<std::vector<glm::vec4>> facePlanes;
+	// next wedge at the same position, a ring per point; empty when no two
+	// vertices share a position
+	Shared<std::vector<VertexID>> seamNext;
+
+	// the LOD
+	Shared<std::vector<uint8_t>> alive;
+	Shared<std::vector<Triangle>> triangles;
+	Shared<std::vector<unsigned int>> indices;
+	// slot of each triangle in indices (-1 when not drawn) and back
+	Shared<std::vector<int32_t>> triangleSlot;
+	Shared<std::vector<TriangleID>> slotTriangle;
+
+	// slots written since version indexLogBase
+	std::vector<uint32_t> indexLog;
+	uint64_t indexLogBase = 0;
 
-	std::vector<Vertex> vertices;
-	std::vector<Triangle> triangles;
-	std::vector<GLuint> indices;
-
-	GLuint VAO{0}, VBO{0}, EBO{0};
 	int aliveCount = 0;
+	Placement placement = Placement::Endpoint;
+
+	// scratch for the batched path: a vertex belongs to the current
+	// selection / affected set when its stamp equals the round
+	std::vector<uint32_t> regionStamp;
+	uint32_t regionRound = 0;
 };
 
 //===================================================Helper Functions================
@@ -208,16 +437,17 @@ cost n
 
 inline float Cost(VertexID u, VertexID v, const Mesh &m)
 {
-	const auto &vertices = m.getVertices();
-	// Combine the quadrics
-	glm::mat4 Q_combined = vertices[u].Q + vertices[v].Q;
-	// v_target is the position u would move to (the position of v)
-	glm::vec4 v_tp(vertices[v].Position, 1.0f);
+	// collapsing a non-manifold edge tears the surface, never pick one
+	EdgeKind kind = m.classifyEdge(u, v);
+	if (kind == EdgeKind::NonManifold)
+		return std::numeric_limits<float>::infinity();
 
-	// Cost = v^T * Q * v
-	float cost = glm::dot(v_tp, Q_combined * v_tp);
+	// Combine the quadrics and evaluate them where v ends up after the
+	// collapse: cost = v^T * Q * v
+	float cost = (m.getQuadric(u) + m.getQuadric(v)).evaluate(m.collapsePosition(u, v));
 
-	if (m.isBoundaryEdge(u, v))
+	// a seam edge has a twin on the other side, it is not a border
+	if (kind == EdgeKind::Boundary && !m.isSeamEdge(u, v))
 	{
 		cost += 100.0f; //edge penalty
 	}
@@ -0,0 +1,95 @@
+#ifndef QUADRIC_H
+#define QUADRIC_H
+
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+//===========================================================================QUADRIC
+// Symmetric 4x4 error quadric, stored as its upper triangle (10 values
+// instead of 16). For a plane p = (a, b, c, d) the quadric is p * p^T, and
+// the error at x is [x 1] Q [x 1]^T, the sum of squared distances to all
+// the planes accumulated into Q.
+// The terms are doubles: the error is a small difference of terms the size
+// of the squared coordinates, and in floats their rounding (about 1e-6 on a
+// unit-sized model) swamps the real error once edges get shorter than about
+// 1e-3, from a few million triangles up. Costs then come out negative and
+// collapses pile onto whichever vertex rounds lowest.
+// That makes it 80 bytes, more than the 64 of the full float mat4 it
+// replaced: the upper triangle only pays for itself in floats (40 bytes),
+// and accuracy won over memory.
+struct Quadric
+{
+	double a2 = 0, ab = 0, ac = 0, ad = 0;
+	double b2 = 0, bc = 0, bd = 0;
+	double c2 = 0, cd = 0;
+	double d2 = 0;
+
+	Quadric() = default;
+
+	// fundamental quadric of the plane ax + by + cz + d = 0
+	explicit Quadric(const glm::vec4 &plane)
+	{
+		double a = plane.x, b = plane.y, c = plane.z, d = plane.w;
+		a2 = a * a, ab = a * b, ac = a * c, ad = a * d;
+		b2 = b * b, bc = b * c, bd = b * d;
+		c2 = c * c, cd = c * d;
+		d2 = d * d;
+	}
+
+	Quadric &operator+=(const Quadric &q)
+	{
+		a2 += q.a2, ab += q.ab, ac += q.ac, ad += q.ad;
+		b2 += q.b2, bc += q.bc, bd += q.bd;
+		c2 += q.c2, cd += q.cd;
+		d2 += q.d2;
+		return *this;
+	}
+
+	Quadric operator+(const Quadric &q) const
+	{
+		Quadric r = *this;
+		r += q;
+		return r;
+	}
+
+	// [p 1] Q [p 1]^T
+	float evaluate(const glm::vec3 &p) const
+	{
+		double x = p.x, y = p.y, z = p.z;
+		return static_cast<float>(a2 * x * x + 2.0 * ab * x * y + 2.0 * ac * x * z + 2.0 * ad * x +
+								  b2 * y * y + 2.0 * bc * y * z + 2.0 * bd * y +
+								  c2 * z * z + 2.0 * cd * z +
+								  d2);
+	}
+
+	// the point of least error, solving A x = -b for the upper 3x3 block A.
+	// Returns false when A is close to singular (flat or straight regions),
+	// the caller then has to pick a position itself
+	bool minimizer(glm::vec3 &out) const
+	{
+		// cofactors of the symmetric A
+		double c00 = b2 * c2 - bc * bc;
+		double c01 = bc * ac - ab * c2;
+		double c02 = ab * bc - b2 * ac;
+		double c11 = a2 * c2 - ac * ac;
+		double c12 = ab * ac - a2 * bc;
+		double c22 = a2 * b2 - ab * ab;
+
+		// near-singular systems fail here rather than producing garbage
+		double det = a2 * c00 + ab * c01 + ac * c02;
+		double scale = a2 + b2 + c2;
+		if (std::abs(det) <= 1e-6 * scale * scale * scale)
+			return false;
+
+		double inv = -1.0 / det;
+		out = glm::vec3(float((c00 * ad + c01 * bd + c02 * cd) * inv),
+						float((c01 * ad + c11 * bd + c12 * cd) * inv),
+						float((c02 * ad + c12 * bd + c22 * cd) * inv));
+		return true;
+	}
+};
+
+static_assert(sizeof(Quadric) == 80, "Quadric layout");
+
+#endif
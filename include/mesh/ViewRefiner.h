@@ -0,0 +1,115 @@
+#ifndef VIEWREFINER_H
+#define VIEWREFINER_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "mesh/pMesh.h"
+
+//===========================================================================VERTEX HIERARCHY
+// One node per collapse in the history: the vertex `to` became after it.
+// Its children are the two nodes it merged, `to` and `from` as they were
+// just before. Bounds cover every descendant, so a node that is off screen,
+// facing away or too small to see says the same of its whole subtree.
+struct vdNode
+{
+	glm::vec3 center;
+	float radius;
+	glm::vec3 coneAxis; // normals of the subtree's faces are within
+	float coneAngle;	// coneAngle radians of coneAxis
+	float error;		// how far the surface may be from full resolution
+};
+
+// what the mesh is refined against
+struct ViewParams
+{
+	glm::mat4 mvp{1.0f};
+	float viewportHeight = 768.0f;
+	// largest surface deviation to leave on screen, in pixels
+	float pixelError = 1.0f;
+	// keep regions facing away from the camera coarse
+	bool cullBackfaces = true;
+	// stop after this long and carry on next frame, 0 = whole mesh
+	double budgetMs = 2.0;
+};
+
+//===========================================================================VIEW REFINER
+// View-dependent LOD over a pMesh history. Any collapse can be undone or
+// redone on its own, as long as its vertices and triangles are exactly as
+// they were when it was recorded:
+//  - its two vertices are live, `to` has taken exactly the collapses into
+//    it that came before this one and `from` all of its own
+//  - on every triangle it changes, exactly the earlier collapses touching
+//    that triangle are applied
+//  - triangles around `from` that earlier collapses removed are removed,
+//    and the triangles a split brings back have live corners
+// A split that needs later collapses undone first splits those too; a
+// collapse that isn't possible yet waits.
+class ViewRefiner
+{
+public:
+	// starts at the base mesh
+	explicit ViewRefiner(const pMesh &pm);
+
+	// one refine/coarsen pass over the live vertices, resuming where the
+	// last pass ran out of time. Returns how many splits and collapses ran
+	int update(const ViewParams &view);
+
+	const Mesh &Current() const { return *mesh; }
+	const std::vector<vdNode> &Nodes() const { return nodes; }
+	int CurrentVerts() const { return mesh->NumVerts(); }
+	int CurrentTriangles() const { return static_cast<int>(mesh->getIndices().size() / 3); }
+
+	// set when an update moved vertices; cleared by the caller after
+	// re-uploading them
+	bool verticesDirty = false;
+
+private:
+	struct Frame;
+
+	void buildHierarchy();
+	bool wantsSplit(int step, const Frame &frame) const;
+	bool canCollapse(int step) const;
+	// step whose split has to come first, -1 if none, -2 if step can't be split
+	int splitBlocker(int step) const;
+	// splits step and whatever has to go first, returns how many splits ran
+	int forceSplit(int step);
+	void collapse(int step);
+	void split(int step);
+	// the node a live vertex stands for, -1 for a full resolution vertex
+	int nodeOf(VertexID v) const;
+	// the collapse that would merge v's node into its parent, -1 if none
+	int parentOf(VertexID v) const;
+
+	std::unique_ptr<Mesh> mesh;
+	std::vector<pVert> history;
+	std::vector<pFace> faces;
+	std::vector<pMove> moves;
+
+	std::vector<vdNode> nodes;
+
+	// collapses into each vertex, in history order (CSR)
+	std::vector<uint32_t> mergeBegin;
+	std::vector<int> merges;
+	std::vector<uint32_t> mergeIndex; // position of each step in its `to` list
+	std::vector<int> removedBy;		  // step collapsing each vertex away, or -1
+	std::vector<uint32_t> merged;	  // applied entries of each vertex's list
+
+	// collapses touching each triangle, in history order (CSR)
+	std::vector<uint32_t> touchBegin;
+	std::vector<int> touches;
+	std::vector<uint32_t> touchIndex; // per faces entry, position in its triangle's list
+	std::vector<uint32_t> touched;	  // applied entries of each triangle's list
+
+	// per step, triangles around `from` that earlier collapses removed (CSR)
+	std::vector<uint32_t> goneBegin;
+	std::vector<TriangleID> gone;
+
+	std::vector<int> splitStack;
+	VertexID cursor = 0;
+};
+
+#endif
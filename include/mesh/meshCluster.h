@@ -0,0 +1,59 @@
+#ifndef MESHCLUSTER_H
+#define MESHCLUSTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mesh/Mesh.h"
+
+/*
+	Out-of-core pre-simplification by vertex clustering (Lindstrom 2000).
+	The input is read once, front to back, as a stream of triangles and
+	never held in memory. Space is cut into a sparse grid of cubic cells;
+	each triangle adds its area-weighted plane quadric to the cells of its
+	three corners and is kept only if they are three different cells.
+	At the end every cell becomes one vertex, placed at the minimum of its
+	quadric (or the mean of its corners where the quadric is singular or
+	the minimum falls outside the cell).
+
+	The grid starts fine and doubles its cell size whenever the cells and
+	kept triangles would pass memoryBudget or maxTriangles, merging cells
+	eight to one. Memory therefore stays within the budget whatever the
+	input size; a larger budget just keeps more detail. The output arrays
+	come on top, but are bounded by maxTriangles and meant to be small
+	enough for Mesh and pMesh to take over from there.
+
+	Inputs are binary or ASCII STL (true triangle soup) and OBJ. OBJ faces
+	index positions anywhere earlier in the file, so those are spilled to
+	an unnamed temporary file and read back through a small block cache
+	that counts against the budget.
+*/
+
+struct ClusterOptions
+{
+	// bytes for the grid, the kept triangles and the OBJ position cache
+	size_t memoryBudget = size_t(256) << 20;
+	// upper bound on output triangles, the grid coarsens to stay under it
+	size_t maxTriangles = size_t(2) << 20;
+	// starting cell size, 0 to take it from the first triangle's edges
+	float cellSize = 0.0f;
+};
+
+struct ClusterStats
+{
+	uint64_t inputTriangles = 0;
+	uint64_t inputBytes = 0;
+	float cellSize = 0.0f; // final
+	int coarsenings = 0;
+	size_t peakBytes = 0; // estimated, same accounting as the budget
+};
+
+// false when the file can't be read or holds no triangles; vertices get
+// positions and area-weighted normals, no texture coordinates
+bool clusterSimplify(const std::string &path, const ClusterOptions &options,
+					 std::vector<Vertex> &vertices, std::vector<Triangle> &triangles,
+					 ClusterStats *stats = nullptr);
+
+#endif
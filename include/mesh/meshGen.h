@@ -0,0 +1,43 @@
+#ifndef MESHGEN_H
+#define MESHGEN_H
+
+#include <cstdint>
+#include <vector>
+
+#include "mesh/Mesh.h"
+
+/*
+	Procedural meshes for scaling tests, any size from a few hundred to
+	hundreds of millions of triangles, built straight into vertex and
+	triangle arrays with no file in between.
+
+		Sphere   geodesic sphere, every face of an icosahedron cut into an
+		         n x n triangle grid: closed, valence 5 and 6
+		Terrain  noisy height field over an n x n grid: open, with a
+		         boundary all around
+		Spokes   disc of rings around one centre vertex joined to every
+		         spoke: a boundary and a single vertex of valence 512
+		Fan      the same disc with about sqrt(triangles) spokes, so the
+		         centre's valence grows with the mesh
+
+	Sizes are a target triangle count; the result is within a few percent
+	of it. The same shape, size and seed always give the same mesh.
+*/
+
+enum class GenShape
+{
+	Sphere,
+	Terrain,
+	Spokes,
+	Fan
+};
+
+const char *genShapeName(GenShape shape);
+
+void generateMesh(GenShape shape, uint64_t targetTriangles, uint32_t seed,
+				  std::vector<Vertex> &vertices, std::vector<Triangle> &triangles);
+
+// geometry only, call ensureSimplification() before timing simplification
+Mesh generateMesh(GenShape shape, uint64_t targetTriangles, uint32_t seed = 1);
+
+#endif
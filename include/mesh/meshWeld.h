@@ -0,0 +1,23 @@
+#ifndef MESHWELD_H
+#define MESHWELD_H
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+/*
+	Position welding over a spatial hash. Positions are bucketed by grid
+	cell (of size epsilon) and each one searches its own and the 26
+	surrounding cells for the lowest-numbered position within epsilon,
+	in parallel on the job system.
+
+	The result maps every position to its representative, which is never
+	after it: remap[i] <= i, and remap[i] == i for the ones that stay.
+	Chains of positions each within epsilon of the next end up on one
+	representative. epsilon 0 merges exact duplicates only.
+*/
+
+std::vector<uint32_t> weldPositions(const std::vector<glm::vec3> &positions, float epsilon);
+
+#endif
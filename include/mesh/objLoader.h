@@ -11,10 +11,33 @@
 #include "mesh/Mesh.h"
 #include <glm/glm.hpp>
 
+struct ObjLoadOptions
+{
+	// merge positions closer than this (mesh/meshWeld.h), 0 for exact
+	// duplicates only; negative leaves every `v` line its own vertex
+	float weldEpsilon = -1.0f;
+	// one vertex per distinct position, normal and uv a face corner uses,
+	// instead of one per position with the last corner's attributes. The
+	// vertices sharing a position are a seam the simplifier keeps closed
+	bool splitSeams = false;
+};
+
 bool loadOBJ(const std::string &path,
 			 std::vector<Vertex> &vertices,
 			 std::vector<Triangle> &triangles,
 			 std::vector<unsigned int> &indices);
-// bool saveOBJ(Mesh *mesh, const std::string path);
+bool loadOBJ(const std::string &path,
+			 std::vector<Vertex> &vertices,
+			 std::vector<Triangle> &triangles,
+			 std::vector<unsigned int> &indices,
+			 const ObjLoadOptions &options);
+
+// reference std::getline based loader; same output as loadOBJ, kept for
+// benchmarking and validating the memory-mapped parser
+bool loadOBJStream(const std::string &path,
+				   std::vector<Vertex> &vertices,
+				   std::vector<Triangle> &triangles,
+				   std::vector<unsigned int> &indices);
+bool saveOBJ(const Mesh &mesh, const std::string &path);
 
 #endif
\ No newline at end of file
@@ -7,26 +7,65 @@
 #include <fstream>
 #include <vector>
 #include <memory>
+#include <cstdint>
+#include <functional>
 
 #include "Mesh.h"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+class pmFile;
+
 //====================================================================pEdge Class
+// one collapse in the history; its changed triangles are
+// faces[facesBegin, facesBegin + faceCount) in the pMesh face log
 struct pVert
 {
 	VertexID from;
 	VertexID to;
+	uint32_t facesBegin;
+	uint32_t faceCount;
 };
 
+// where the surviving vertex `to` of a collapse was before and after it.
+// Only recorded with Placement::Optimal, half-edge collapses never move it
+struct pMove
+{
+	glm::vec3 before;
+	glm::vec3 after;
+};
+
+// how Initialize() picks collapses
+struct SimplifyOptions
+{
+	// 0: one collapse at a time in strict cost order. Otherwise each round
+	// looks at the cheapest batchWindow * (live vertices) candidates and
+	// collapses every one whose neighbourhood no cheaper pick touched, in
+	// parallel. On one core rounds are slower than the greedy loop, more so
+	// for wider windows; what several cores gain is not measured
+	float batchWindow = 0.0f;
+};
+
+// called every so often during simplification with the fraction of
+// collapses done; returning false stops there, the history ends early
+using SimplifyProgress = std::function<bool(float)>;
+
 //=====================================================================pMESH CLASS
 class pMesh
 {
 public:
 	explicit pMesh(const Mesh &source, float maxDistance = 100.0f);
+	pMesh(const Mesh &source, const SimplifyOptions &options, const SimplifyProgress &progress = nullptr);
+	// playback only, copied from a saved progressive mesh; file can be
+	// closed afterwards
+	explicit pMesh(const pmFile &file);
+	// playback only, from full resolution geometry and a recorded history
+	pMesh(std::vector<Vertex> verts, std::vector<Triangle> tris,
+		  std::vector<pVert> records, std::vector<pFace> changes,
+		  std::vector<pMove> moved = {});
 
-	void Initialize();
+	void Initialize(const SimplifyProgress &progress = nullptr);
 	void Update(int targetVerts);
 	void Reset();
 
@@ -35,19 +74,43 @@ public:
 		return maxVerts - history.size();
 	}
 
-	void Draw(GLuint programID, const glm::mat4 &MVP);
+	// the mesh at the current LOD, for rendering or export
+	const Mesh &Current() const { return *progressive; }
+	const std::vector<pVert> &History() const { return history; }
+	const std::vector<pFace> &Faces() const { return faces; }
+	// one per history record, or empty if no collapse moved a vertex
+	const std::vector<pMove> &Moves() const { return moves; }
+	// LOD changes also change vertex positions, not only the index list
+	bool MovesVertices() const { return !moves.empty(); }
+	// what the history was built with, kept in a .pm so a cache can be checked
+	Placement getPlacement() const { return progressive->getPlacement(); }
+	const SimplifyOptions &Options() const { return simplify; }
+	// vertex attributes at full resolution, whatever the current LOD
+	std::vector<Vertex> OriginalVertices() const;
 
 	int MaxVerts() const { return maxVerts; }
 	int CurrentVerts() const { return progressive->NumVerts(); }
 	int HistorySize() const { return static_cast<int>(history.size()); }
+	// the progressive mesh and the recorded history, see Mesh::memoryBytes
+	size_t memoryBytes() const;
 
+	// collapses or splits from the current step to stepIndex, so the cost
+	// follows the size of the LOD change, not the size of the mesh
 	void UpdateToStep(int stepIndex);
 
 private:
-	Mesh original;
+	// replay / undo history[step] on the progressive mesh
+	void applyCollapse(int step);
+	void applySplit(int step);
+	void simplifyGreedy(Mesh &work, const SimplifyProgress &progress);
+	void simplifyBatched(Mesh &work, const SimplifyProgress &progress);
+
 	std::unique_ptr<Mesh> progressive;
 
 	std::vector<pVert> history;
+	std::vector<pFace> faces;
+	std::vector<pMove> moves;
+	SimplifyOptions simplify;
 	int currentHistoryIndex = 0;
 	int maxVerts = 0;
 };
@@ -0,0 +1,61 @@
+#ifndef PMBUILD_H
+#define PMBUILD_H
+
+#include <memory>
+#include <string>
+
+#include "mesh/Mesh.h"
+#include "mesh/pMesh.h"
+
+//===========================================================================BUILD JOB
+// Builds the progressive mesh for an OBJ on a background thread: from the
+// .pm cache next to it when that is up to date and was built with the same
+// placement and options, otherwise by loading and simplifying it and
+// refreshing the cache. The caller polls. The full
+// resolution mesh can be taken as soon as it has loaded, so it can be shown
+// while the history is still being built. Nothing here touches GL.
+class pmBuildJob
+{
+public:
+	enum class Phase
+	{
+		Loading,
+		Simplifying,
+		Done,
+		Cancelled,
+		Failed
+	};
+
+	// progress, when given, is called from the job's thread as well
+	explicit pmBuildJob(const std::string &objPath, Placement placement = Placement::Optimal,
+						SimplifyOptions options = {}, SimplifyProgress progress = nullptr);
+	// cancels without waiting, the thread finishes on its own
+	~pmBuildJob();
+
+	// stops at the next progress check; nothing is cached or handed out.
+	// The same happens when the progress callback returns false
+	void cancel();
+	// cancels every job and waits for its thread. Call before exit: the
+	// threads use the job system and write cache files
+	static void waitAll();
+
+	Phase phase() const;
+	// of the current phase, 0 to 1
+	float Progress() const;
+	const std::string &Path() const { return path; }
+
+	// the full resolution mesh once loaded (not from the cache), only once
+	std::unique_ptr<Mesh> takeMesh();
+	// once Done, only once
+	std::unique_ptr<pMesh> takeProgressive();
+
+private:
+	struct Shared;
+	struct Running;
+	static Running &running();
+
+	std::shared_ptr<Shared> shared;
+	std::string path;
+};
+
+#endif
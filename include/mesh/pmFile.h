@@ -0,0 +1,104 @@
+#ifndef PMFILE_H
+#define PMFILE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "io/MappedFile.h"
+#include "mesh/pMesh.h"
+
+/*
+	.pm binary progressive mesh
+
+	Sections are the in-memory record types written out as they are, so
+	nothing is parsed: loadPM maps the file, checks the header and every
+	index in one pass, and copies the sections into a playback pMesh (the
+	history, faces and moves as they are, vertices and triangles into a
+	Mesh with its incidence and edge table). The mapping is closed after
+	that. All integers are little-endian, every section starts on a 16
+	byte boundary.
+
+		pmHeader
+		pmVertex   [vertexCount]    full resolution vertex attributes
+		pmTriangle [triangleCount]  full resolution triangles
+		pVert      [recordCount]    collapse history, in collapse order
+		pFace      [faceCount]      triangles changed by each collapse
+		pMove      [moveCount]      0, or one per record for optimal placement
+*/
+
+constexpr char kPMMagic[4] = {'P', 'M', 'S', 'H'};
+constexpr uint32_t kPMVersion = 3;
+
+struct pmHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t vertexCount;
+	uint32_t triangleCount;
+	uint32_t recordCount;
+	uint32_t faceCount;
+	uint64_t vertexOffset;
+	uint64_t triangleOffset;
+	uint64_t recordOffset;
+	uint64_t faceOffset;
+	uint32_t moveCount;
+	uint32_t placement; // Placement the history was built with
+	uint64_t moveOffset;
+	float batchWindow;	// SimplifyOptions::batchWindow it was built with
+	uint32_t reserved;
+};
+
+struct pmVertex
+{
+	float position[3];
+	float normal[3];
+	float uv[2];
+};
+
+struct pmTriangle
+{
+	int32_t verts[3];
+};
+
+static_assert(sizeof(pmHeader) == 80, "pmHeader layout");
+static_assert(sizeof(pmVertex) == 32, "pmVertex layout");
+static_assert(sizeof(pmTriangle) == 12, "pmTriangle layout");
+static_assert(sizeof(pVert) == 16, "pVert layout");
+static_assert(sizeof(pFace) == 16, "pFace layout");
+static_assert(sizeof(pMove) == 24, "pMove layout");
+
+//===========================================================================PM FILE
+// A mapped .pm file. The section pointers stay valid while the object lives.
+class pmFile
+{
+public:
+	// maps the file and checks the header and section bounds
+	bool open(const std::string &path);
+
+	const pmHeader &header() const { return *hdr; }
+	const pmVertex *vertices() const { return section<pmVertex>(hdr->vertexOffset); }
+	const pmTriangle *triangles() const { return section<pmTriangle>(hdr->triangleOffset); }
+	const pVert *records() const { return section<pVert>(hdr->recordOffset); }
+	const pFace *faces() const { return section<pFace>(hdr->faceOffset); }
+	const pMove *moves() const { return section<pMove>(hdr->moveOffset); }
+
+private:
+	template <typename T>
+	const T *section(uint64_t offset) const
+	{
+		return reinterpret_cast<const T *>(file.data() + offset);
+	}
+
+	bool validate() const;
+
+	MappedFile file;
+	const pmHeader *hdr = nullptr;
+};
+
+bool savePM(const pMesh &pm, const std::string &path);
+// nullptr if the file is missing, not a .pm or fails validation. The
+// result is a copy and does not keep the file open
+std::unique_ptr<pMesh> loadPM(const std::string &path);
+
+#endif
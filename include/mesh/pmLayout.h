@@ -0,0 +1,59 @@
+#ifndef PMLAYOUT_H
+#define PMLAYOUT_H
+
+#include <cstdint>
+#include <vector>
+
+#include "mesh/pMesh.h"
+
+/*
+	Vertex-split ordered buffers
+
+	Vertices are sorted in reverse collapse order: the base mesh first, then
+	the vertex each split brings back, coarse to fine. After n collapses the
+	live vertices are exactly the first MaxVerts - n. Triangles are sorted by
+	the collapse that removes them, last removed first, so the live ones are
+	a prefix too.
+
+	A triangle's corners still depend on the LOD, so each level carries its
+	own index list over that prefix. Levels are spaced geometrically in
+	vertex count, which keeps all of them together within a small multiple
+	of the full resolution index list. When collapses move vertices
+	(Placement::Optimal) each level also gets its own slice of vertices;
+	otherwise every level draws from the one full resolution slice.
+
+	Picking a LOD is then only a choice of draw range.
+*/
+
+struct pmLevel
+{
+	uint32_t step;		  // history steps collapsed at this level
+	uint32_t vertexCount; // live vertices, a prefix of the level's slice
+	uint32_t baseVertex;  // first vertex of the level's slice
+	uint32_t firstIndex;
+	uint32_t indexCount; // slice relative
+	// farthest any collapse so far left one of its vertices from the
+	// faces around it, in model units
+	float error;
+};
+
+// the finest level at or past `step`, so a level never has more vertices
+// than asked for. levels is finest first and must not be empty
+const pmLevel &levelFor(const std::vector<pmLevel> &levels, int step);
+
+struct pmLayout
+{
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	// finest first, step 0 to the whole history
+	std::vector<pmLevel> levels;
+	// position of each original vertex in the split order
+	std::vector<uint32_t> rank;
+
+	const pmLevel &levelFor(int step) const { return ::levelFor(levels, step); }
+};
+
+// levelRatio is the vertex count of each level over the one before it
+pmLayout buildPrefixLayout(const pMesh &pm, float levelRatio = 0.8f);
+
+#endif
@@ -0,0 +1,162 @@
+#ifndef PMSTREAM_H
+#define PMSTREAM_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mesh/Mesh.h"
+#include "mesh/pMesh.h"
+#include "mesh/pmFile.h"
+
+/*
+	.pms streamed progressive mesh
+
+	Same data as a .pm, ordered so it can be shown while it is still
+	arriving: the coarsest (base) mesh first, then the vertex splits from
+	coarse to fine, each carrying the vertex it brings back and where the
+	vertex it was collapsed onto goes back to. Everything is
+	little-endian and tightly packed, records are variable length.
+
+		pmStreamHeader
+		pmStreamVertex [baseVertexCount]    vertices alive in the base mesh
+		pFace          [baseTriangleCount]  non-degenerate base triangles
+		splits, recordCount times:
+			pmStreamSplit
+			pFace [faceCount]               corners to restore
+*/
+
+constexpr char kPMStreamMagic[4] = {'P', 'M', 'S', 'T'};
+constexpr uint32_t kPMStreamVersion = 2;
+
+struct pmStreamHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t vertexCount;
+	uint32_t triangleCount;
+	uint32_t baseVertexCount;
+	uint32_t baseTriangleCount;
+	uint32_t recordCount;
+	uint32_t reserved;
+};
+
+struct pmStreamVertex
+{
+	int32_t id;
+	pmVertex attr;
+};
+
+struct pmStreamSplit
+{
+	int32_t from; // vertex brought back by the split
+	int32_t to;	  // vertex it was collapsed onto
+	uint32_t faceCount;
+	pmVertex attr; // attributes of `from`
+	float toPosition[3]; // position of `to` before the collapse
+};
+
+static_assert(sizeof(pmStreamHeader) == 32, "pmStreamHeader layout");
+static_assert(sizeof(pmStreamVertex) == 36, "pmStreamVertex layout");
+static_assert(sizeof(pmStreamSplit) == 56, "pmStreamSplit layout");
+
+bool savePMStream(const pMesh &pm, const std::string &path);
+
+//===========================================================================STREAM DECODER
+// Incremental .pms decoder. Bytes can be fed in pieces of any size; the
+// mesh exists once the base section has arrived and splits are applied
+// only when refine() is called, so refinement can be budgeted per frame.
+class pmStreamDecoder
+{
+public:
+	void feed(const char *data, size_t size);
+	// no more bytes will come; a stream that stops short of its last
+	// record, or before its header, fails here
+	void finish();
+
+	// apply buffered splits, at most maxSplits and stopping once budgetMs
+	// has elapsed (0 = no time limit). Returns how many were applied.
+	int refine(int maxSplits, double budgetMs = 0.0);
+
+	bool hasBase() const { return baseReady; }
+	bool failed() const { return state == State::Failed; }
+	// all splits received and applied
+	bool complete() const;
+
+	int SplitsReceived() const { return splitsReady; }
+	int SplitsApplied() const { return applied; }
+	int TotalSplits() const { return static_cast<int>(header.recordCount); }
+	size_t BytesReceived() const { return received; }
+
+	// set when refine() brought back vertices whose attributes the GPU has
+	// not seen yet; cleared by the caller after re-uploading
+	bool verticesDirty = false;
+
+	const Mesh &Current() const { return *mesh; }
+
+	// once complete, hand the decoded data over as a full pMesh
+	std::unique_ptr<pMesh> takeProgressive();
+
+private:
+	enum class State
+	{
+		Header,
+		BaseVertices,
+		BaseTriangles,
+		SplitHeader,
+		SplitFaces,
+		Done,
+		Failed
+	};
+
+	void parse();
+	void fail(const char *why);
+	bool validVert(int32_t v) const { return v >= 0 && static_cast<uint32_t>(v) < header.vertexCount; }
+	bool validTri(int32_t t) const { return t >= 0 && static_cast<uint32_t>(t) < header.triangleCount; }
+
+	State state = State::Header;
+	std::vector<char> pending;
+	size_t readPos = 0;
+	size_t received = 0;
+
+	pmStreamHeader header{};
+	uint32_t itemsLeft = 0;
+	pmStreamSplit currentSplit{};
+
+	std::unique_ptr<Mesh> mesh;
+	bool baseReady = false;
+	// splits in coarse to fine order; faces hold the corners to restore.
+	// the last split may still be waiting for its faces
+	std::vector<pVert> splits;
+	std::vector<pFace> faces;
+	// per split: `to` position to restore (before) and, once applied, the
+	// one it replaced (after)
+	std::vector<pMove> moves;
+	int splitsReady = 0;
+	int applied = 0;
+};
+
+//===========================================================================STREAM READER
+// Pulls a .pms from a file, or stdin for "-", on a background thread so a
+// slow pipe never stalls the caller. poll() hands what has arrived so far
+// to the decoder.
+class pmStreamReader
+{
+public:
+	explicit pmStreamReader(const std::string &path);
+	~pmStreamReader();
+
+	// feed newly arrived bytes to the decoder; returns false on a read error
+	// or once the input has ended before the whole stream arrived
+	bool poll();
+
+	pmStreamDecoder &decoder() { return dec; }
+
+private:
+	struct Shared;
+	std::shared_ptr<Shared> shared;
+	pmStreamDecoder dec;
+};
+
+#endif
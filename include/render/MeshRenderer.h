@@ -0,0 +1,87 @@
+#ifndef MESHRENDERER_H
+#define MESHRENDERER_H
+
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <glm/glm.hpp>
+
+#include "mesh/Mesh.h"
+#include "mesh/pmLayout.h"
+
+//===========================================================================RENDER VERTEX
+// What actually goes to the GPU, 20 bytes per vertex: position as floats,
+// the normal as a GL_INT_2_10_10_10_REV snorm and the uvs as half floats.
+// Built from the Mesh attribute arrays on upload; the simplifier state
+// never leaves the CPU.
+struct RenderVertex
+{
+	float position[3];
+	uint32_t normal;
+	uint32_t texCoords;
+};
+
+static_assert(sizeof(RenderVertex) == 20, "RenderVertex layout");
+
+//===========================================================================MESH RENDERER
+// Owns the GL objects for a Mesh. Kept out of Mesh itself so the simplifier
+// can be built and run without a GL context.
+class MeshRenderer
+{
+public:
+	MeshRenderer() = default;
+	MeshRenderer(const MeshRenderer &) = delete;
+	MeshRenderer &operator=(const MeshRenderer &) = delete;
+	~MeshRenderer();
+
+	// (re)create the VAO/VBO/EBO from the mesh's vertices and indices
+	void Upload(const Mesh &mesh);
+	// bring the index buffer up to date after the mesh changed LOD. Only the
+	// slots the mesh logged since the last upload are sent, as a few
+	// glBufferSubData runs; a full upload only when the log can't say
+	void UpdateIndices(const Mesh &mesh);
+	// re-upload the vertex buffer after vertex attributes changed
+	void UpdateVertices(const Mesh &mesh);
+
+	// upload every level of a split ordered layout at once. Until the next
+	// Upload, Draw shows the level picked by SelectStep
+	void UploadLayout(const pmLayout &layout);
+	// pick the level for a history step; no GL calls, only the draw range
+	// changes. Returns that level's vertex count
+	int SelectStep(int step);
+	// one level of the uploaded layout, instanceCount times. The caller
+	// binds the program; model matrices come from instanceBuffer into
+	// attributes 3-6, starting at firstInstance
+	void DrawInstanced(const pmLevel &level, GLuint instanceBuffer, size_t firstInstance, GLsizei instanceCount);
+	bool HasLayout() const { return !levels.empty(); }
+	// the EBO and how many of its indices are drawn, for checks that read it back
+	GLuint IndexBuffer() const { return EBO; }
+	GLsizei IndexCount() const { return indexCount; }
+	int LevelVertices() const { return static_cast<int>(drawLevel.vertexCount); }
+
+	void Draw(GLuint programID, const glm::mat4 &MVP);
+
+private:
+	void createGL();
+	void destroyGL();
+	void packVertices(const Mesh &mesh);
+	void uploadAllIndices(const Mesh &mesh);
+
+	GLuint VAO{0}, VBO{0}, EBO{0};
+	GLsizei indexCount = 0;
+	// split ordered layout, when one is uploaded
+	std::vector<pmLevel> levels;
+	pmLevel drawLevel{};
+	// the EBO holds every triangle, so LOD changes never reallocate it
+	size_t indexCapacity = 0;
+	// Mesh::indexVersion() of the last index upload
+	uint64_t indexVersion = 0;
+	std::vector<uint32_t> dirtySlots;
+	// staging buffer, kept around so re-uploads do not reallocate
+	std::vector<RenderVertex> packed;
+};
+
+#endif
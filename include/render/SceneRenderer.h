@@ -0,0 +1,37 @@
+#ifndef SCENERENDERER_H
+#define SCENERENDERER_H
+
+#include <memory>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include "render/MeshRenderer.h"
+#include "scene/LodManager.h"
+
+//===========================================================================SCENE RENDERER
+// Draws what a LodManager selected: every asset's layout uploaded once,
+// this frame's instance transforms streamed into one buffer, then one
+// instanced draw per asset and level.
+class SceneRenderer
+{
+public:
+	SceneRenderer() = default;
+	SceneRenderer(const SceneRenderer &) = delete;
+	SceneRenderer &operator=(const SceneRenderer &) = delete;
+	~SceneRenderer();
+
+	// upload the layouts of assets added since the last call
+	void Upload(const LodManager &lods);
+	// expects a program reading u_viewProj and a mat4 at attribute 3
+	void Draw(GLuint programID, const glm::mat4 &viewProj, const LodManager &lods);
+
+private:
+	std::vector<std::unique_ptr<MeshRenderer>> assets;
+	GLuint instanceVBO{0};
+	size_t instanceCapacity = 0;
+};
+
+#endif
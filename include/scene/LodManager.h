@@ -0,0 +1,115 @@
+#ifndef LODMANAGER_H
+#define LODMANAGER_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "mesh/pMesh.h"
+#include "mesh/pmLayout.h"
+
+//===========================================================================LOD MANAGER
+// LOD selection for many instances of a few assets. Each asset is one
+// split ordered layout (mesh/pmLayout.h), built once and shared by all of
+// its instances; an instance is a transform and an asset.
+//
+// Every update culls the instances against the view frustum and gives each
+// visible one the coarsest level whose error stays under the pixel
+// tolerance at its distance. If that adds up to more triangles than the
+// budget, the tolerance is raised for everyone until it fits. Instances
+// that ended on the same asset and level come out as one instanced draw.
+//
+// The per-instance work is a few passes over flat arrays: a sphere-plane
+// test, one multiply for the tolerance and table lookups, no branches on
+// the data and nothing per instance allocated.
+
+// instances of `asset` at `level`, transforms [firstInstance,
+// firstInstance + instanceCount) of LodManager::DrawTransforms()
+struct LodDraw
+{
+	int asset;
+	int level;
+	uint32_t firstInstance;
+	uint32_t instanceCount;
+};
+
+struct LodSettings
+{
+	float viewportHeight = 768.0f;
+	// largest error to leave on screen, in pixels
+	float pixelError = 1.0f;
+	// most triangles to draw in total, 0 for no limit
+	uint64_t triangleBudget = 0;
+};
+
+struct LodStats
+{
+	uint32_t visible = 0;
+	uint64_t triangles = 0;
+	// how much the pixel tolerance was raised to meet the budget
+	float toleranceScale = 1.0f;
+};
+
+class LodManager
+{
+public:
+	// builds the asset's layout; levelRatio as for buildPrefixLayout
+	int addAsset(const pMesh &pm, float levelRatio = 0.8f);
+	int addInstance(int asset, const glm::mat4 &transform);
+	void setTransform(int instance, const glm::mat4 &transform);
+	void clearInstances();
+
+	void update(const glm::mat4 &viewProj, const LodSettings &settings);
+
+	const std::vector<LodDraw> &Draws() const { return draws; }
+	// instance transforms in draw order
+	const std::vector<glm::mat4> &DrawTransforms() const { return drawTransforms; }
+	const LodStats &Stats() const { return stats; }
+
+	int AssetCount() const { return static_cast<int>(assets.size()); }
+	int InstanceCount() const { return static_cast<int>(transforms.size()); }
+	const pmLayout &Layout(int asset) const { return *assets[asset].layout; }
+
+	// tolerances are looked up in quarter octave buckets, 2^((b - kBucketOne) / 4)
+	static constexpr int kBuckets = 256;
+	static constexpr int kBucketOne = 128;
+
+private:
+	struct Asset
+	{
+		std::shared_ptr<const pmLayout> layout;
+		// bounding sphere in model units
+		glm::vec3 center;
+		float radius;
+		// first of this asset's levels in the group counts
+		uint32_t groupBase;
+	};
+
+	uint64_t trianglesAt(int shift) const;
+
+	std::vector<Asset> assets;
+	// per asset and bucket: the coarsest level within that tolerance, and
+	// its triangle count
+	std::vector<uint8_t> bucketLevel;
+	std::vector<uint32_t> bucketTriangles;
+	uint32_t groupCount = 0;
+
+	// per instance, structure of arrays
+	std::vector<float> centerX, centerY, centerZ, radius;
+	// world units per model unit, for the asset's error
+	std::vector<float> scale;
+	std::vector<uint32_t> assetOf;
+	std::vector<glm::mat4> transforms;
+
+	// per update
+	std::vector<int32_t> bucket; // asset * kBuckets + bucket, -1 when culled
+	std::vector<uint32_t> keyCount; // visible instances per asset and bucket
+	std::vector<uint32_t> groupStart;
+	std::vector<LodDraw> draws;
+	std::vector<glm::mat4> drawTransforms;
+	LodStats stats;
+};
+
+#endif
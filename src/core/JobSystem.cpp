@@ -0,0 +1,171 @@
+#include <cstdlib>
+#include <string>
+
+#include "core/JobSystem.h"
+
+namespace
+{
+	// which pool, and which worker of it, the current thread is
+	thread_local const JobSystem *tlsPool = nullptr;
+	thread_local int tlsIndex = -1;
+}
+
+#pragma region JobSystem
+JobSystem::JobSystem(unsigned workers)
+{
+	for (unsigned i = 0; i < workers + 1; ++i)
+		queues.push_back(std::make_unique<Queue>());
+
+	for (unsigned i = 0; i < workers; ++i)
+		threads.emplace_back(&JobSystem::workerLoop, this, static_cast<int>(i));
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> guard(sleepLock);
+		stopping = true;
+	}
+	wake.notify_all();
+
+	for (auto &t : threads)
+		t.join();
+}
+
+JobSystem &JobSystem::global()
+{
+	static JobSystem pool([]()
+						  {
+							  unsigned n = std::max(1u, std::thread::hardware_concurrency());
+							  if (const char *env = std::getenv("PM_THREADS"))
+								  n = std::max(1, std::atoi(env));
+							  return n - 1; }());
+	return pool;
+}
+
+void JobSystem::submit(JobCounter &counter, Job job)
+{
+	counter.count.fetch_add(1, std::memory_order_relaxed);
+
+	int self = tlsPool == this ? tlsIndex : static_cast<int>(queues.size()) - 1;
+	{
+		std::lock_guard<std::mutex> guard(queues[self]->lock);
+		queues[self]->jobs.push_back([job = std::move(job), &counter]()
+									 {
+										 job();
+										 counter.count.fetch_sub(1, std::memory_order_release); });
+	}
+	queued.fetch_add(1, std::memory_order_release);
+
+	// taking the lock orders this against a worker about to sleep, so the
+	// notify can't slip in between its check and its wait
+	{
+		std::lock_guard<std::mutex> guard(sleepLock);
+	}
+	wake.notify_one();
+}
+
+bool JobSystem::runOne(int self)
+{
+	Job job;
+
+	// own work newest first, it is most likely still in cache
+	{
+		Queue &own = *queues[self];
+		std::lock_guard<std::mutex> guard(own.lock);
+		if (!own.jobs.empty())
+		{
+			job = std::move(own.jobs.back());
+			own.jobs.pop_back();
+		}
+	}
+
+	// otherwise steal the oldest job of someone else
+	for (size_t i = 1; !job && i < queues.size(); ++i)
+	{
+		Queue &victim = *queues[(self + i) % queues.size()];
+		std::lock_guard<std::mutex> guard(victim.lock);
+		if (!victim.jobs.empty())
+		{
+			job = std::move(victim.jobs.front());
+			victim.jobs.pop_front();
+		}
+	}
+
+	if (!job)
+		return false;
+
+	queued.fetch_sub(1, std::memory_order_relaxed);
+	job();
+	return true;
+}
+
+void JobSystem::wait(JobCounter &counter)
+{
+	int self = tlsPool == this ? tlsIndex : static_cast<int>(queues.size()) - 1;
+	while (counter.count.load(std::memory_order_acquire) > 0)
+	{
+		if (!runOne(self))
+			std::this_thread::yield();
+	}
+}
+
+void JobSystem::workerLoop(int index)
+{
+	tlsPool = this;
+	tlsIndex = index;
+
+	while (true)
+	{
+		if (runOne(index))
+			continue;
+
+		std::unique_lock<std::mutex> lock(sleepLock);
+		wake.wait(lock, [this]()
+				  { return stopping || queued.load(std::memory_order_acquire) > 0; });
+		if (stopping && queued.load() == 0)
+			return;
+	}
+}
+#pragma endregion
+
+#pragma region TaskGraph
+TaskGraph::TaskID TaskGraph::add(std::function<void()> fn)
+{
+	nodes.push_back(std::make_unique<Node>());
+	nodes.back()->fn = std::move(fn);
+	return static_cast<TaskID>(nodes.size() - 1);
+}
+
+void TaskGraph::precede(TaskID before, TaskID after)
+{
+	nodes[before]->next.push_back(after);
+	nodes[after]->dependencies++;
+}
+
+void TaskGraph::run(JobSystem &jobs)
+{
+	for (auto &n : nodes)
+		n->remaining = n->dependencies;
+
+	JobCounter counter;
+	for (TaskID id = 0; id < static_cast<TaskID>(nodes.size()); ++id)
+		if (nodes[id]->dependencies == 0)
+			launch(jobs, counter, id);
+
+	jobs.wait(counter);
+}
+
+void TaskGraph::launch(JobSystem &jobs, JobCounter &counter, TaskID id)
+{
+	// successors are submitted before this job counts as done, so the
+	// counter can't reach zero while the graph still has work
+	jobs.submit(counter, [this, &jobs, &counter, id]()
+				{
+					Node &node = *nodes[id];
+					node.fn();
+					for (TaskID next : node.next)
+						if (nodes[next]->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+							launch(jobs, counter, next); });
+}
+#pragma endregion
@@ -0,0 +1,189 @@
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "core/Stats.h"
+
+namespace
+{
+	// blocks outlive their threads, so counts from finished workers stay in
+	// the sums
+	std::mutex registryLock;
+	std::vector<std::unique_ptr<StatBlock>> &registry()
+	{
+		static std::vector<std::unique_ptr<StatBlock>> blocks;
+		return blocks;
+	}
+
+	std::atomic<uint64_t> peaks[static_cast<int>(StatPeak::Count)];
+
+	// raw sums at the last reset, guarded by registryLock. Resetting by
+	// subtraction leaves the blocks to their owners alone
+	StatsSnapshot baseline;
+
+	StatsSnapshot sumBlocks()
+	{
+		StatsSnapshot s;
+		for (const auto &b : registry())
+		{
+			for (int i = 0; i < static_cast<int>(Stat::Count); ++i)
+				s.counts[i] += b->counts[i].load(std::memory_order_relaxed);
+			for (int i = 0; i < static_cast<int>(StatTimer::Count); ++i)
+			{
+				s.seconds[i] += b->nanoseconds[i].load(std::memory_order_relaxed) * 1e-9;
+				s.calls[i] += b->calls[i].load(std::memory_order_relaxed);
+			}
+		}
+		return s;
+	}
+}
+
+StatBlock &statBlock()
+{
+	thread_local StatBlock *block = nullptr;
+	if (!block)
+	{
+		std::lock_guard<std::mutex> guard(registryLock);
+		registry().push_back(std::make_unique<StatBlock>());
+		block = registry().back().get();
+	}
+	return *block;
+}
+
+void statPeak(StatPeak p, uint64_t value)
+{
+#ifndef PM_NO_STATS
+	std::atomic<uint64_t> &peak = peaks[static_cast<int>(p)];
+	uint64_t seen = peak.load(std::memory_order_relaxed);
+	while (value > seen && !peak.compare_exchange_weak(seen, value, std::memory_order_relaxed))
+	{
+	}
+#else
+	(void)p;
+	(void)value;
+#endif
+}
+
+StatsSnapshot statsSnapshot()
+{
+	std::lock_guard<std::mutex> guard(registryLock);
+	StatsSnapshot s = sumBlocks();
+	for (int i = 0; i < static_cast<int>(Stat::Count); ++i)
+		s.counts[i] -= baseline.counts[i];
+	for (int i = 0; i < static_cast<int>(StatTimer::Count); ++i)
+	{
+		s.seconds[i] -= baseline.seconds[i];
+		s.calls[i] -= baseline.calls[i];
+	}
+	for (int i = 0; i < static_cast<int>(StatPeak::Count); ++i)
+		s.peaks[i] = peaks[i].load(std::memory_order_relaxed);
+	return s;
+}
+
+void statsReset()
+{
+	std::lock_guard<std::mutex> guard(registryLock);
+	baseline = sumBlocks();
+	for (auto &peak : peaks)
+		peak.store(0, std::memory_order_relaxed);
+}
+
+bool statsEnabled()
+{
+#ifndef PM_NO_STATS
+	return true;
+#else
+	return false;
+#endif
+}
+
+double StatsSnapshot::collapsesPerSecond() const
+{
+	double seconds = (*this)[StatTimer::Simplify];
+	return seconds > 0.0 ? (*this)[Stat::Collapses] / seconds : 0.0;
+}
+
+const char *statName(Stat s)
+{
+	switch (s)
+	{
+	case Stat::Collapses:
+		return "collapses";
+	case Stat::CostEvaluations:
+		return "cost_evaluations";
+	case Stat::StalePops:
+		return "stale_pops";
+	case Stat::ReplaySteps:
+		return "replay_steps";
+	case Stat::BytesUploaded:
+		return "bytes_uploaded";
+	case Stat::Uploads:
+		return "uploads";
+	case Stat::Count:
+		break;
+	}
+	return "unknown";
+}
+
+const char *statName(StatPeak p)
+{
+	switch (p)
+	{
+	case StatPeak::QueueSize:
+		return "queue_size";
+	case StatPeak::Count:
+		break;
+	}
+	return "unknown";
+}
+
+const char *statName(StatTimer t)
+{
+	switch (t)
+	{
+	case StatTimer::Prepare:
+		return "prepare";
+	case StatTimer::Simplify:
+		return "simplify";
+	case StatTimer::Replay:
+		return "replay";
+	case StatTimer::IndexUpdate:
+		return "index_update";
+	case StatTimer::Upload:
+		return "upload";
+	case StatTimer::Count:
+		break;
+	}
+	return "unknown";
+}
+
+void writeStatsJSON(std::ostream &out, const StatsSnapshot &stats, const char *indent)
+{
+	char line[256];
+	out << "{\n";
+	out << indent << "  \"enabled\": " << (statsEnabled() ? "true" : "false") << ",\n";
+
+	out << indent << "  \"counters\": {";
+	for (int i = 0; i < static_cast<int>(Stat::Count); ++i)
+		out << (i ? ", " : "") << "\"" << statName(static_cast<Stat>(i)) << "\": " << stats.counts[i];
+	out << "},\n";
+
+	out << indent << "  \"peaks\": {";
+	for (int i = 0; i < static_cast<int>(StatPeak::Count); ++i)
+		out << (i ? ", " : "") << "\"" << statName(static_cast<StatPeak>(i)) << "\": " << stats.peaks[i];
+	out << "},\n";
+
+	out << indent << "  \"timers\": {";
+	for (int i = 0; i < static_cast<int>(StatTimer::Count); ++i)
+	{
+		snprintf(line, sizeof(line), "%s\"%s\": {\"seconds\": %.6f, \"calls\": %llu}", i ? ", " : "",
+				 statName(static_cast<StatTimer>(i)), stats.seconds[i], (unsigned long long)stats.calls[i]);
+		out << line;
+	}
+	out << "},\n";
+
+	snprintf(line, sizeof(line), "%.1f", stats.collapsesPerSecond());
+	out << indent << "  \"collapses_per_second\": " << line << "\n";
+	out << indent << "}";
+}
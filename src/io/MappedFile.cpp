@@ -0,0 +1,149 @@
+#include <utility>
+
+#include "io/MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+{
+	*this = std::move(other);
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept
+{
+	if (this == &other)
+		return *this;
+
+	close();
+	std::swap(view, other.view);
+	std::swap(length, other.length);
+	std::swap(opened, other.opened);
+#ifdef _WIN32
+	std::swap(fileHandle, other.fileHandle);
+	std::swap(mappingHandle, other.mappingHandle);
+#endif
+	return *this;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string &path)
+{
+	close();
+
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+							  OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize))
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	fileHandle = file;
+	length = static_cast<size_t>(fileSize.QuadPart);
+	opened = true;
+
+	// an empty file can't be mapped, but is still a valid (empty) file
+	if (length == 0)
+		return true;
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping)
+	{
+		close();
+		return false;
+	}
+	mappingHandle = mapping;
+
+	view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!view)
+	{
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (view)
+		UnmapViewOfFile(view);
+	if (mappingHandle)
+		CloseHandle(static_cast<HANDLE>(mappingHandle));
+	if (fileHandle)
+		CloseHandle(static_cast<HANDLE>(fileHandle));
+
+	view = nullptr;
+	mappingHandle = nullptr;
+	fileHandle = nullptr;
+	length = 0;
+	opened = false;
+}
+
+#else
+
+bool MappedFile::open(const std::string &path)
+{
+	close();
+
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+	{
+		::close(fd);
+		return false;
+	}
+
+	length = static_cast<size_t>(st.st_size);
+	opened = true;
+
+	// an empty file can't be mapped, but is still a valid (empty) file
+	if (length == 0)
+	{
+		::close(fd);
+		return true;
+	}
+
+	void *p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd); // the mapping keeps its own reference to the file
+
+	if (p == MAP_FAILED)
+	{
+		length = 0;
+		opened = false;
+		return false;
+	}
+
+	view = p;
+	madvise(view, length, MADV_SEQUENTIAL);
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (view)
+		munmap(view, length);
+
+	view = nullptr;
+	length = 0;
+	opened = false;
+}
+
+#endif
@@ -4,6 +4,8 @@
 #include <fstream>
 #include <vector>
 #include <filesystem>
+#include <algorithm>
+#include <cmath>
 
 // GLAD & GLFW
 #include <glad/glad.h> // glad must be included before glfw
@@ -23,8 +25,16 @@
 // #include <SDL.h>
 
 #include "controls/controls.hpp"
+#include "core/Stats.h"
 #include "mesh/Mesh.h"
 #include "mesh/pMesh.h"
+#include "mesh/pmBuild.h"
+#include "mesh/pmLayout.h"
+#include "mesh/pmStream.h"
+#include "mesh/ViewRefiner.h"
+#include "render/MeshRenderer.h"
+#include "render/SceneRenderer.h"
+#include "scene/LodManager.h"
 #include "shader/shaderLoader.hpp"
 
 using std::cout;
@@ -55,6 +65,10 @@ float initialFoV = 45.0f;
 float speed = 3.0f; // 3 units / second
 float mouseSpeed = 0.005f;
 
+// refinement budget per frame while a .pms is streaming in
+const int kStreamSplitsPerFrame = 2000;
+const double kStreamBudgetMs = 4.0;
+
 int main(int argc, char *argv[])
 {
 	// set_root_path(argv[0]);
@@ -110,6 +124,8 @@ int main(int argc, char *argv[])
 	// Create and compile our GLSL program from the shaders, from openGL tutorial
 	GLuint programID = LoadShaders("./data/shaders/ga_constant_color_vert.glsl",
 								   "./data/shaders/ga_constant_color_frag.glsl");
+	GLuint instancedProgramID = LoadShaders("./data/shaders/ga_instanced_vert.glsl",
+											"./data/shaders/ga_constant_color_frag.glsl");
 
 	// Dark blue background
 	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
@@ -128,10 +144,99 @@ int main(int argc, char *argv[])
 	// Keep track of the current selection
 	static int currentModelIndex = 0;
 
+	// --stream <file.pms | -> shows a streamed progressive mesh while it loads
+	std::unique_ptr<pmStreamReader> stream;
+	bool streamUploaded = false;
+	if (argc > 2 && std::string(argv[1]) == "--stream")
+		stream = std::make_unique<pmStreamReader>(argv[2]);
+
 	// Create meshes
-	Mesh mesh = Mesh(modelFiles[currentModelIndex]);
-	pMesh progressive = pMesh(mesh);
-	int max = /*mesh->NumVerts()*/ mesh.NumVerts();
+	std::unique_ptr<pMesh> progressive;
+	MeshRenderer renderer;
+
+	// draw from split ordered buffers: every LOD is uploaded once and the
+	// slider only changes the draw range, snapping to the nearest level
+	bool prefixBuffers = false;
+	// refine each frame against the camera instead of one LOD for the mesh
+	bool viewDependent = false;
+	float pixelError = 1.0f;
+	std::unique_ptr<ViewRefiner> refiner;
+	// a grid of copies of the model, each at the level the LOD manager picks
+	bool instancedScene = false;
+	int sceneInstances = 1024;
+	int triangleBudgetK = 0; // thousands, 0 for no limit
+	std::unique_ptr<LodManager> lods;
+	std::unique_ptr<SceneRenderer> sceneRenderer;
+	// counters as of the previous frame, for per-frame upload figures
+	StatsSnapshot lastStats;
+	auto buildScene = [&]()
+	{
+		lods.reset();
+		sceneRenderer.reset();
+		if (!instancedScene || !progressive)
+			return;
+
+		lods = std::make_unique<LodManager>();
+		int asset = lods->addAsset(*progressive);
+
+		glm::vec3 lo(1e30f), hi(-1e30f);
+		for (const Vertex &v : lods->Layout(asset).vertices)
+		{
+			lo = glm::min(lo, v.Position);
+			hi = glm::max(hi, v.Position);
+		}
+		float spacing = 1.5f * std::max({hi.x - lo.x, hi.y - lo.y, hi.z - lo.z, 1e-6f});
+		int side = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(sceneInstances))));
+		for (int i = 0; i < sceneInstances; ++i)
+		{
+			glm::vec3 offset((i % side - 0.5f * (side - 1)) * spacing, 0.0f, (i / side - 0.5f * (side - 1)) * spacing);
+			lods->addInstance(asset, glm::translate(glm::mat4(1.0f), offset));
+		}
+
+		sceneRenderer = std::make_unique<SceneRenderer>();
+		sceneRenderer->Upload(*lods);
+	};
+	auto uploadProgressive = [&]()
+	{
+		buildScene();
+		refiner.reset();
+		if (viewDependent)
+		{
+			refiner = std::make_unique<ViewRefiner>(*progressive);
+			renderer.Upload(refiner->Current());
+		}
+		else if (prefixBuffers)
+			renderer.UploadLayout(buildPrefixLayout(*progressive));
+		else
+			renderer.Upload(progressive->Current());
+	};
+	// show the LOD after `step` collapses
+	auto showStep = [&](int step)
+	{
+		if (refiner)
+			return;
+		if (renderer.HasLayout())
+		{
+			renderer.SelectStep(step);
+			return;
+		}
+		progressive->UpdateToStep(step);
+		if (progressive->MovesVertices())
+			renderer.UpdateVertices(progressive->Current());
+		renderer.UpdateIndices(progressive->Current());
+	};
+
+	// models are loaded and simplified in the background (or read from
+	// their .pm cache); until then the previous model stays up
+	std::unique_ptr<pmBuildJob> build;
+	auto startBuild = [&](int index)
+	{
+		build = std::make_unique<pmBuildJob>(modelFiles[index]);
+	};
+
+	int max = 0;
+	if (!stream)
+		startBuild(currentModelIndex);
 	int current = max;
 	int targetVerts = max;
 
@@ -159,17 +264,112 @@ int main(int argc, char *argv[])
 		glm::mat4 ModelMatrix = glm::mat4(1.0);
 		glm::mat4 MVP = ProjectionMatrix * ViewMatrix * ModelMatrix;
 
+		// a budgeted refine/coarsen pass against this frame's camera
+		if (refiner)
+		{
+			int width, height;
+			glfwGetFramebufferSize(window, &width, &height);
+
+			ViewParams view;
+			view.mvp = MVP;
+			view.viewportHeight = static_cast<float>(height);
+			view.pixelError = pixelError;
+			if (refiner->update(view) > 0)
+			{
+				if (refiner->verticesDirty)
+					renderer.UpdateVertices(refiner->Current());
+				renderer.UpdateIndices(refiner->Current());
+				refiner->verticesDirty = false;
+			}
+		}
+
+		if (lods)
+		{
+			int width, height;
+			glfwGetFramebufferSize(window, &width, &height);
+
+			LodSettings settings;
+			settings.viewportHeight = static_cast<float>(height);
+			settings.pixelError = pixelError;
+			settings.triangleBudget = static_cast<uint64_t>(triangleBudgetK) * 1000;
+			lods->update(ProjectionMatrix * ViewMatrix, settings);
+		}
+
+		// the new model at full resolution as soon as it has loaded, then the
+		// progressive mesh and its buffers once the history is built; GL
+		// only ever on this thread
+		if (build)
+		{
+			if (auto mesh = build->takeMesh())
+			{
+				progressive.reset();
+				refiner.reset();
+				buildScene();
+				renderer.Upload(*mesh);
+			}
+
+			pmBuildJob::Phase phase = build->phase();
+			if (phase == pmBuildJob::Phase::Done)
+			{
+				progressive = build->takeProgressive();
+				build.reset();
+				uploadProgressive();
+				max = current = targetVerts = progressive->MaxVerts();
+			}
+			else if (phase == pmBuildJob::Phase::Failed || phase == pmBuildJob::Phase::Cancelled)
+			{
+				if (phase == pmBuildJob::Phase::Failed)
+					fprintf(stderr, "Failed to build progressive mesh for %s\n", build->Path().c_str());
+				build.reset();
+			}
+		}
+
+		// draw the base mesh as soon as it has arrived, then refine a bounded
+		// number of vertex splits per frame as more of the stream comes in
+		if (stream)
+		{
+			pmStreamDecoder &dec = stream->decoder();
+			if (!stream->poll())
+			{
+				fprintf(stderr, "Failed to stream progressive mesh, building %s instead\n",
+						modelFiles[currentModelIndex].c_str());
+				stream.reset();
+				startBuild(currentModelIndex);
+			}
+			else if (dec.hasBase())
+			{
+				dec.refine(kStreamSplitsPerFrame, kStreamBudgetMs);
+				if (!streamUploaded)
+					renderer.Upload(dec.Current());
+				else if (dec.verticesDirty)
+				{
+					renderer.UpdateVertices(dec.Current());
+					renderer.UpdateIndices(dec.Current());
+				}
+				streamUploaded = true;
+				dec.verticesDirty = false;
+
+				if (dec.complete())
+				{
+					progressive = dec.takeProgressive();
+					uploadProgressive();
+					max = current = targetVerts = progressive->MaxVerts();
+					stream.reset();
+				}
+			}
+		}
+
 		// decrease the vertex count with spacebar
-		if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS && current > 0)
+		if (progressive && glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS && current > 0)
 		{
 			current--;
-			progressive.Update(current);
+			showStep(progressive->MaxVerts() - current);
 		}
 
-		if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS && current < max)
+		if (progressive && glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS && current < max)
 		{
 			current++;
-			progressive.Update(current);
+			showStep(progressive->MaxVerts() - current);
 		}
 
 		// draw imgui
@@ -188,9 +388,8 @@ int main(int argc, char *argv[])
 				{
 					currentModelIndex = n;
 
-					mesh = Mesh(modelFiles[n]);
-					progressive = pMesh(mesh);
-					targetVerts = progressive.MaxVerts();
+					stream.reset();
+					startBuild(n);
 				}
 
 				if (isSelected)
@@ -199,26 +398,121 @@ int main(int argc, char *argv[])
 			ImGui::EndCombo();
 		}
 
-		int minVerts = progressive.MinVerts();
-		int maxVerts = progressive.MaxVerts();
+		if (build)
+		{
+			bool simplifying = build->phase() == pmBuildJob::Phase::Simplifying;
+			ImGui::Text("%s %s", simplifying ? "Simplifying" : "Loading",
+						fs::path(build->Path()).filename().string().c_str());
+			ImGui::ProgressBar(simplifying ? build->Progress() : 0.0f);
+			if (ImGui::Button("Cancel"))
+				build->cancel();
+		}
 
-		if (ImGui::SliderInt("LOD", &targetVerts, minVerts, maxVerts))
+		if (progressive)
 		{
-			// Find nearest history step that reaches <= targetVerts
-			int step = 0;
-			while (step < progressive.HistorySize() &&
-				   (progressive.MaxVerts() - step) > targetVerts)
+			int minVerts = progressive->MinVerts();
+			int maxVerts = progressive->MaxVerts();
+
+			// every collapse removes one vertex, so step n leaves MaxVerts - n
+			int step = std::clamp(progressive->MaxVerts() - targetVerts, 0, progressive->HistorySize());
+
+			if (ImGui::Checkbox("View dependent", &viewDependent))
 			{
+				uploadProgressive();
+				showStep(step);
+			}
 
-				++step;
+			if (refiner)
+			{
+				ImGui::SliderFloat("Pixel error", &pixelError, 0.25f, 16.0f);
+				ImGui::Text("Refined: %d vertices, %d triangles",
+							refiner->CurrentVerts(), refiner->CurrentTriangles());
+			}
+			else if (ImGui::SliderInt("LOD", &targetVerts, minVerts, maxVerts))
+			{
+				step = std::clamp(progressive->MaxVerts() - targetVerts, 0, progressive->HistorySize());
+				showStep(step);
 			}
 
-			progressive.UpdateToStep(step);
+			if (ImGui::Checkbox("Instanced scene", &instancedScene))
+				buildScene();
+			if (lods)
+			{
+				// rebuilt once the slider is let go, not on every drag
+				ImGui::SliderInt("Instances", &sceneInstances, 1, 100000);
+				if (ImGui::IsItemDeactivatedAfterEdit())
+					buildScene();
+				if (!refiner)
+					ImGui::SliderFloat("Pixel error", &pixelError, 0.25f, 16.0f);
+				ImGui::SliderInt("Triangle budget (K)", &triangleBudgetK, 0, 20000);
+				const LodStats &stats = lods->Stats();
+				ImGui::Text("Scene: %u / %d visible, %llu triangles, %zu draws, tolerance x%.2f",
+							stats.visible, lods->InstanceCount(), (unsigned long long)stats.triangles,
+							lods->Draws().size(), stats.toleranceScale);
+			}
+
+			if (ImGui::Checkbox("Prefix buffers", &prefixBuffers))
+			{
+				// the progressive mesh stays where it was while the layout draws,
+				// catch it up before going back to it
+				if (!prefixBuffers)
+					progressive->UpdateToStep(step);
+				uploadProgressive();
+				showStep(step);
+			}
+
+			// Display current vertex count
+			ImGui::Text("Current vertices: %d / %d / %d", minVerts, targetVerts, maxVerts);
+			if (renderer.HasLayout())
+				ImGui::Text("Drawn level: %d vertices", renderer.LevelVertices());
+		}
+		else if (stream)
+		{
+			pmStreamDecoder &dec = stream->decoder();
+			ImGui::Text("Streaming: %zu KB, %d / %d splits applied",
+						dec.BytesReceived() / 1024, dec.SplitsApplied(), dec.TotalSplits());
+			if (dec.hasBase())
+				ImGui::Text("Current vertices: %d", dec.Current().NumVerts());
 		}
 
-		// Display current vertex count
-		ImGui::Text("Current vertices: %d / %d / %d", minVerts, targetVerts, maxVerts);
+		ImGui::End();
 
+		ImGui::Begin("Stats");
+		{
+			StatsSnapshot stats = statsSnapshot();
+			if (!statsEnabled())
+				ImGui::Text("Built with PM_ENABLE_STATS=OFF");
+
+			ImGui::Text("Collapses: %llu (%.0f / s)", (unsigned long long)stats[Stat::Collapses],
+						stats.collapsesPerSecond());
+			ImGui::Text("Cost evaluations: %llu", (unsigned long long)stats[Stat::CostEvaluations]);
+			ImGui::Text("Stale pops: %llu", (unsigned long long)stats[Stat::StalePops]);
+			ImGui::Text("Peak queue: %llu", (unsigned long long)stats[StatPeak::QueueSize]);
+			ImGui::Text("Replay steps: %llu", (unsigned long long)stats[Stat::ReplaySteps]);
+			ImGui::Text("Uploaded: %.1f MB in %llu writes, %.1f KB this frame",
+						stats[Stat::BytesUploaded] / 1048576.0, (unsigned long long)stats[Stat::Uploads],
+						(stats[Stat::BytesUploaded] - std::min(stats[Stat::BytesUploaded], lastStats[Stat::BytesUploaded])) / 1024.0);
+
+			ImGui::Separator();
+			for (int t = 0; t < static_cast<int>(StatTimer::Count); ++t)
+				ImGui::Text("%-13s %9.2f ms %8llu calls", statName(static_cast<StatTimer>(t)),
+							stats.seconds[t] * 1e3, (unsigned long long)stats.calls[t]);
+
+			ImGui::Separator();
+			if (progressive)
+				ImGui::Text("Progressive mesh: %.1f MB", progressive->memoryBytes() / 1048576.0);
+
+			if (ImGui::Button("Reset"))
+				statsReset();
+			ImGui::SameLine();
+			if (ImGui::Button("Save stats.json"))
+			{
+				std::ofstream out("stats.json");
+				writeStatsJSON(out, stats);
+				out << "\n";
+			}
+			lastStats = stats;
+		}
 		ImGui::End();
 
 		// Render ImGui
@@ -228,7 +522,10 @@ int main(int argc, char *argv[])
 		// Wireframe on
 		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
-		progressive.Draw(programID, MVP);
+		if (lods)
+			sceneRenderer->Draw(instancedProgramID, ProjectionMatrix * ViewMatrix, *lods);
+		else
+			renderer.Draw(programID, MVP);
 		// Back to normal (optional)
 		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 
@@ -239,6 +536,8 @@ int main(int argc, char *argv[])
 	} while (glfwGetKey(window, GLFW_KEY_ESCAPE) != GLFW_PRESS &&
 			 !glfwWindowShouldClose(window));
 
+	// background builds still use the job system, stop them before statics go
+	pmBuildJob::waitAll();
 	glfwTerminate();
 
 	// free imgui resources
@@ -0,0 +1,124 @@
+#include <algorithm>
+
+#include "mesh/CollapseHeap.h"
+
+void CollapseHeap::build(std::vector<VertexCost> entries, size_t vertexCount)
+{
+	heap = std::move(entries);
+	slot.assign(vertexCount, -1);
+	for (size_t i = 0; i < heap.size(); ++i)
+		slot[heap[i].u] = static_cast<int32_t>(i);
+
+	// Floyd's heapify, sift down every internal node from the last up
+	for (size_t i = heap.size() / 2; i-- > 0;)
+		siftDown(i);
+
+	counters.inserts += heap.size();
+	counters.peakSize = std::max(counters.peakSize, heap.size());
+}
+
+void CollapseHeap::update(const VertexCost &e)
+{
+	if (static_cast<size_t>(e.u) >= slot.size())
+		slot.resize(e.u + 1, -1);
+
+	if (slot[e.u] < 0)
+	{
+		heap.push_back(e);
+		slot[e.u] = static_cast<int32_t>(heap.size() - 1);
+		siftUp(heap.size() - 1);
+
+		counters.inserts++;
+		counters.peakSize = std::max(counters.peakSize, heap.size());
+		return;
+	}
+
+	size_t i = slot[e.u];
+	bool cheaper = before(e, heap[i]);
+	heap[i] = e;
+	if (cheaper)
+		siftUp(i);
+	else
+		siftDown(i);
+
+	counters.updates++;
+}
+
+void CollapseHeap::erase(VertexID u)
+{
+	if (!contains(u))
+		return;
+
+	removeAt(slot[u]);
+	counters.erases++;
+}
+
+void CollapseHeap::clear()
+{
+	heap.clear();
+	slot.clear();
+}
+
+VertexCost CollapseHeap::pop()
+{
+	VertexCost e = heap.front();
+	removeAt(0);
+	counters.pops++;
+	return e;
+}
+
+void CollapseHeap::place(size_t i, const VertexCost &e)
+{
+	heap[i] = e;
+	slot[e.u] = static_cast<int32_t>(i);
+}
+
+void CollapseHeap::siftUp(size_t i)
+{
+	VertexCost e = heap[i];
+	while (i > 0)
+	{
+		size_t parent = (i - 1) / 2;
+		if (!before(e, heap[parent]))
+			break;
+		place(i, heap[parent]);
+		i = parent;
+	}
+	place(i, e);
+}
+
+void CollapseHeap::siftDown(size_t i)
+{
+	VertexCost e = heap[i];
+	size_t n = heap.size();
+	while (true)
+	{
+		size_t child = 2 * i + 1;
+		if (child >= n)
+			break;
+		if (child + 1 < n && before(heap[child + 1], heap[child]))
+			child++;
+		if (!before(heap[child], e))
+			break;
+		place(i, heap[child]);
+		i = child;
+	}
+	place(i, e);
+}
+
+void CollapseHeap::removeAt(size_t i)
+{
+	slot[heap[i].u] = -1;
+
+	VertexCost last = heap.back();
+	heap.pop_back();
+	if (i == heap.size())
+		return;
+
+	// the last entry fills the hole and moves whichever way it has to
+	place(i, last);
+	if (i > 0 && before(last, heap[(i - 1) / 2]))
+		siftUp(i);
+	else
+		siftDown(i);
+}
@@ -0,0 +1,67 @@
+#include "mesh/EdgeTable.h"
+
+void EdgeTable::reset(size_t edges)
+{
+	// keep the load factor under one half
+	size_t capacity = 16;
+	while (capacity < edges * 2)
+		capacity *= 2;
+
+	slots.assign(capacity, {kEmpty, 0});
+	mask = capacity - 1;
+	used = 0;
+}
+
+size_t EdgeTable::find(uint64_t key) const
+{
+	// Fibonacci hashing spreads the packed vertex ids over the table
+	size_t i = (key * 0x9E3779B97F4A7C15ull) >> 32 & mask;
+	while (slots[i].key != key && slots[i].key != kEmpty)
+		i = (i + 1) & mask;
+	return i;
+}
+
+void EdgeTable::add(VertexID a, VertexID b, int delta)
+{
+	if ((used + 1) * 2 > slots.size())
+		grow();
+
+	uint64_t key = makeKey(a, b);
+	Slot &s = slots[find(key)];
+	if (s.key == kEmpty)
+	{
+		s.key = key;
+		used++;
+	}
+	s.count += delta;
+}
+
+uint32_t EdgeTable::count(VertexID a, VertexID b) const
+{
+	if (slots.empty())
+		return 0;
+
+	const Slot &s = slots[find(makeKey(a, b))];
+	return s.key == kEmpty ? 0 : s.count;
+}
+
+void EdgeTable::grow()
+{
+	std::vector<Slot> old = std::move(slots);
+
+	// edges that dropped to zero are not carried over, so a table full of
+	// them is rebuilt at the same size instead of doubling
+	size_t live = 0;
+	for (const Slot &s : old)
+		if (s.key != kEmpty && s.count != 0)
+			live++;
+	reset(live * 2);
+
+	for (const Slot &s : old)
+	{
+		if (s.key == kEmpty || s.count == 0)
+			continue;
+		slots[find(s.key)] = s;
+		used++;
+	}
+}
@@ -1,7 +1,12 @@
 #include <algorithm> /* min/max */
+#include <limits>
+#include <utility>
 
 #include "mesh/Mesh.h"
 #include "mesh/objLoader.h"
+#include "mesh/meshWeld.h"
+#include "core/JobSystem.h"
+#include "core/Stats.h"
 
 //================================ EDGE FUNCTIONS ==================================
 #pragma region Edge
@@ -18,51 +23,166 @@ glm::vec3 Triangle::getNormal(const Mesh &m) const
 {
     if (isDegenerate()) return glm::vec3(0.0f);
 
-	const auto &vertices = m.getVertices();
+	const auto &positions = m.getPositions();
 
-    const glm::vec3 &p0 = vertices[verts[0]].Position;
-    const glm::vec3 &p1 = vertices[verts[1]].Position;
-    const glm::vec3 &p2 = vertices[verts[2]].Position;
+    const glm::vec3 &p0 = positions[verts[0]];
+    const glm::vec3 &p1 = positions[verts[1]];
+    const glm::vec3 &p2 = positions[verts[2]];
 
     // Standard cross product of two edges
     glm::vec3 edge1 = p1 - p0;
     glm::vec3 edge2 = p2 - p0;
 
-    // Use normalize to get a unit vector; length might be zero if colinear
+    // Use normalize to get a unit vector; length might be zero if colinear.
+    // The test is relative to the edges, a fixed bound would drop every
+    // triangle of a dense mesh (edges under 1e-3 on a unit-sized model)
     glm::vec3 n = glm::cross(edge1, edge2);
     float len = glm::length(n);
     
-    return (len > 1e-6f) ? n / len : glm::vec3(0.0f);
+    return (len > 1e-6f * glm::length(edge1) * glm::length(edge2)) ? n / len : glm::vec3(0.0f);
 }
 
 #pragma endregion
 
+#pragma region Incidence
+void IncidenceTable::build(const std::vector<Triangle> &tris, size_t vertexCount)
+{
+	// count, then lay the slices out back to back with a couple of spare
+	// slots each, then fill in triangle order
+	slices.assign(vertexCount, {0, 0, 0});
+	for (const Triangle &t : tris)
+		for (VertexID v : t.verts)
+			slices[v].count++;
+
+	uint32_t offset = 0;
+	for (Slice &s : slices)
+	{
+		s.begin = offset;
+		s.capacity = s.count + 2;
+		s.count = 0;
+		offset += s.capacity;
+	}
+
+	items.assign(offset, -1);
+	wasted = 0;
+	for (size_t i = 0; i < tris.size(); ++i)
+		for (VertexID v : tris[i].verts)
+		{
+			Slice &s = slices[v];
+			items[s.begin + s.count++] = static_cast<TriangleID>(i);
+		}
+}
+
+void IncidenceTable::add(VertexID u, TriangleID t)
+{
+	Slice &s = slices[u];
+	if (s.count == s.capacity)
+		relocate(u, s.count + 1);
+
+	items[s.begin + s.count++] = t;
+}
+
+void IncidenceTable::reserve(VertexID u, uint32_t extra)
+{
+	const Slice &s = slices[u];
+	if (s.count + extra > s.capacity)
+		relocate(u, s.count + extra);
+}
+
+void IncidenceTable::relocate(VertexID u, uint32_t minCapacity)
+{
+	// out of room, move the slice to the end with space to grow
+	if (wasted > items.size() / 2)
+		compact();
+
+	Slice &s = slices[u];
+	uint32_t capacity = std::max(s.capacity * 2 + 2, minCapacity);
+	uint32_t begin = static_cast<uint32_t>(items.size());
+	items.resize(items.size() + capacity, -1);
+	std::copy(items.begin() + s.begin, items.begin() + s.begin + s.count, items.begin() + begin);
+
+	wasted += s.capacity;
+	s.begin = begin;
+	s.capacity = capacity;
+}
+
+void IncidenceTable::remove(VertexID u, TriangleID t)
+{
+	Slice &s = slices[u];
+	for (uint32_t i = 0; i < s.count; ++i)
+	{
+		if (items[s.begin + i] == t)
+		{
+			items[s.begin + i] = items[s.begin + s.count - 1];
+			s.count--;
+			return;
+		}
+	}
+}
+
+void IncidenceTable::compact()
+{
+	std::vector<TriangleID> packed;
+	packed.reserve(items.size() - wasted);
+
+	for (Slice &s : slices)
+	{
+		uint32_t begin = static_cast<uint32_t>(packed.size());
+		packed.insert(packed.end(), items.begin() + s.begin, items.begin() + s.begin + s.capacity);
+		s.begin = begin;
+	}
+
+	items = std::move(packed);
+	wasted = 0;
+}
+#pragma endregion
+
 #pragma region Mesh
 
 // copy constructor
 Mesh::Mesh(const Mesh &m)
-	: vertices(m.vertices),
+	: positions(m.positions),
+	  normals(m.normals),
+	  texCoords(m.texCoords),
+	  collapseQueue(m.collapseQueue),
+	  quadrics(m.quadrics),
+	  vertTriangles(m.vertTriangles),
+	  edgeFaces(m.edgeFaces),
+	  destiny(m.destiny),
+	  facePlanes(m.facePlanes),
+	  seamNext(m.seamNext),
+	  alive(m.alive),
 	  triangles(m.triangles),
-	  indices(m.indices)
+	  indices(m.indices),
+	  triangleSlot(m.triangleSlot),
+	  slotTriangle(m.slotTriangle),
+	  indexLog(m.indexLog),
+	  indexLogBase(m.indexLogBase),
+	  aliveCount(m.aliveCount),
+	  placement(m.placement)
 {
-	for (auto &v : vertices)
-		v.alive = true;
-
-	aliveCount = vertices.size();
-	computeInitialQuadrics();
-	setupMesh();
+	// the batch scratch is not copied, it starts over at round 0
 }
 
 Mesh::Mesh(const std::string &path)
+	: Mesh(path, ObjLoadOptions())
 {
-	loadOBJ(path, vertices, triangles, indices);
+}
 
-	for (auto &v : vertices)
-		v.alive = true;
+Mesh::Mesh(const std::string &path, const ObjLoadOptions &options)
+{
+	std::vector<Vertex> verts;
+	loadOBJ(path, verts, triangles.write(), indices.write(), options);
 
-	aliveCount = vertices.size();
-	computeInitialQuadrics();
-	setupMesh();
+	setAttributes(verts);
+	prepareSimplification(true);
+}
+
+Mesh::Mesh(const std::vector<Vertex> &verts, std::vector<Triangle> tris)
+	: triangles(std::move(tris))
+{
+	setAttributes(verts);
+	updateIndices();
 }
 
 Mesh &Mesh::operator=(const Mesh &m)
@@ -70,331 +190,1005 @@ Mesh &Mesh::operator=(const Mesh &m)
 	if (this == &m)
 		return *this;
 
-	this->vertices = m.vertices;
+	this->positions = m.positions;
+	this->normals = m.normals;
+	this->texCoords = m.texCoords;
+	this->collapseQueue = m.collapseQueue;
+	this->quadrics = m.quadrics;
+	this->vertTriangles = m.vertTriangles;
+	this->edgeFaces = m.edgeFaces;
+	this->destiny = m.destiny;
+	this->facePlanes = m.facePlanes;
+	this->seamNext = m.seamNext;
+	this->alive = m.alive;
 	this->triangles = m.triangles;
+	this->indices = m.indices;
+	this->triangleSlot = m.triangleSlot;
+	this->slotTriangle = m.slotTriangle;
+	this->indexLog = m.indexLog;
+	this->indexLogBase = m.indexLogBase;
+	this->aliveCount = m.aliveCount;
+	this->placement = m.placement;
+
+	this->regionStamp.clear();
+	this->regionRound = 0;
+
+	return *this;
+}
+
+// adjacency and face planes are independent, quadrics need both and the
+// queue needs the quadrics and the seams. Each step is itself split over
+// the job system
+void Mesh::prepareSimplification(bool needAdjacency)
+{
+	StatScope timer(StatTimer::Prepare);
+
+	// unshare up front, the tasks below write from several threads
+	collapseQueue.write();
+	quadrics.write();
+	vertTriangles.write();
+	edgeFaces.write();
+	destiny.write();
+	facePlanes.write();
+	seamNext.write();
+
+	TaskGraph graph;
+	TaskGraph::TaskID adjacency = graph.add([this, needAdjacency]()
+											{ if (needAdjacency) buildAdjacency(); });
+	TaskGraph::TaskID seams = graph.add([this]()
+										{ buildSeams(); });
+	TaskGraph::TaskID planes = graph.add([this]()
+										 { computeFacePlanes(); });
+	TaskGraph::TaskID quadric = graph.add([this]()
+										  { computeInitialQuadrics(); });
+	TaskGraph::TaskID queue = graph.add([this]()
+										{ initCollapseQueue(); });
+
+	graph.precede(adjacency, quadric);
+	graph.precede(adjacency, seams);
+	graph.precede(planes, quadric);
+	graph.precede(quadric, queue);
+	graph.precede(seams, queue);
+	graph.run(JobSystem::global());
+}
 
-	for (auto &tri : this->triangles)
+void Mesh::ensureSimplification()
+{
+	if (quadrics->size() != positions->size())
+		prepareSimplification(vertTriangles->vertexCount() != positions->size());
+}
+
+void Mesh::setAttributes(const std::vector<Vertex> &verts)
+{
+	size_t n = verts.size();
+	std::vector<glm::vec3> &P = positions.write();
+	std::vector<glm::vec3> &N = normals.write();
+	std::vector<glm::vec2> &T = texCoords.write();
+	P.resize(n);
+	N.resize(n);
+	T.resize(n);
+	for (size_t i = 0; i < n; ++i)
 	{
-		for (int i = 0; i < tri.verts.size(); i++)
-		{
-			VertexID id = tri.verts[i];
-			tri.verts[i] = id;
-		}
+		P[i] = verts[i].Position;
+		N[i] = verts[i].Normal;
+		T[i] = verts[i].TexCoords;
 	}
-	this->indices = m.indices;
 
-	this->setupMesh();
+	alive.write().assign(n, 1);
+	aliveCount = n;
+}
 
-	return *this;
+void Mesh::setVertex(VertexID u, const Vertex &v)
+{
+	positions.write()[u] = v.Position;
+	normals.write()[u] = v.Normal;
+	texCoords.write()[u] = v.TexCoords;
 }
 
-void Mesh::initCollapseQueue()
+// per-vertex triangle lists, in triangle order
+void Mesh::buildAdjacency()
 {
-	collapseQueue = std::priority_queue<VertexCost>();
-	cachedCosts.resize(vertices.size(), std::numeric_limits<float>::max());
+	vertTriangles.write().build(*triangles, positions->size());
+
+	// a closed manifold has 1.5 edges per triangle
+	edgeFaces.write().reset(triangles->size() * 3 / 2 + 16);
+	for (const Triangle &t : *triangles)
+		countEdges(t.verts, +1);
+}
 
-	for (VertexID u = 0; u < vertices.size(); ++u)
+void Mesh::buildSeams()
+{
+	std::vector<VertexID> &next = seamNext.write();
+	next.clear();
+
+	// exact duplicates only, a seam is wedges of the very same point
+	std::vector<uint32_t> same = weldPositions(*positions, 0.0f);
+	bool any = false;
+	std::vector<VertexID> ring(positions->size()), head(positions->size(), -1);
+	for (VertexID u = 0; u < static_cast<VertexID>(ring.size()); ++u)
 	{
-		if (!vertices[u].alive)
+		ring[u] = u;
+		if (!alive[u] || vertTriangles[u].size() == 0)
 			continue;
 
-		VertexID bestV = -1;
-		float minCost = std::numeric_limits<float>::max();
-
-		for (VertexID v : vertices[u].neighbors)
+		// the first used wedge of a point heads its ring
+		VertexID &first = head[same[u]];
+		if (first < 0)
 		{
-			if (!vertices[v].alive)
-				continue;
-			float c = Cost(u, v, *this);
-			if (c < minCost)
-			{
-				minCost = c;
-				bestV = v;
-			}
+			first = u;
+			continue;
 		}
 
-		if (bestV != -1)
-		{
-			cachedCosts[u] = minCost;
-			vertices[u].destiny = bestV;
-			collapseQueue.push({u, bestV, minCost});
-		}
+		ring[u] = ring[first];
+		ring[first] = u;
+		any = true;
 	}
+
+	if (any)
+		next = std::move(ring);
 }
 
-Mesh::~Mesh()
+void Mesh::addSeamSiblings(std::vector<VertexID> &affected) const
 {
-	destroyGL();
+	if (seamNext->empty())
+		return;
+
+	for (size_t i = 0, n = affected.size(); i < n; ++i)
+		for (VertexID w = seamNext[affected[i]]; w != affected[i]; w = seamNext[w])
+			if (std::find(affected.begin(), affected.end(), w) == affected.end())
+				affected.push_back(w);
 }
 
-int Mesh::NumVerts() const
+void Mesh::addPointRings(VertexID v, std::vector<VertexID> &affected) const
 {
-	return aliveCount;
+	std::vector<VertexID> ring;
+	VertexID w = v;
+	do
+	{
+		gatherNeighbors(w, ring);
+		ring.push_back(w);
+		for (VertexID n : ring)
+			if (std::find(affected.begin(), affected.end(), n) == affected.end())
+				affected.push_back(n);
+		w = onSeam(v) ? seamNext[w] : v;
+	} while (w != v);
 }
 
-void Mesh::setupMesh()
+bool Mesh::samePoint(VertexID u, VertexID v) const
 {
-	glGenVertexArrays(1, &this->VAO);
-	glGenBuffers(1, &this->VBO);
-	glGenBuffers(1, &this->EBO);
+	if (u == v)
+		return true;
+	if (!onSeam(u))
+		return false;
+
+	for (VertexID w = seamNext[u]; w != u; w = seamNext[w])
+		if (w == v)
+			return true;
+	return false;
+}
 
-	glBindVertexArray(this->VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
+void Mesh::seamSiblings(VertexID u, VertexID v, std::vector<VertexCost> &out) const
+{
+	out.clear();
+	if (!onSeam(u))
+		return;
 
-	glBufferData(GL_ARRAY_BUFFER, this->vertices.size() * sizeof(Vertex),
-				 &this->vertices[0], GL_STATIC_DRAW);
+	const bool hasNormals = !normals->empty();
+	for (VertexID w = seamNext[u]; w != u; w = seamNext[w])
+	{
+		if (!alive[w])
+			continue;
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->EBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->indices.size() * sizeof(GLuint),
-				 &this->indices[0], GL_STATIC_DRAW);
+		// the wedge of v's point on w's side, else the closest in normal
+		VertexID target = -1;
+		float bestDot = -2.0f;
+		VertexID x = v;
+		do
+		{
+			if (alive[x])
+			{
+				if (edgeFaces->count(w, x) > 0)
+				{
+					target = x;
+					break;
+				}
+
+				float d = hasNormals ? glm::dot(normals[w], normals[x]) : -1.0f;
+				if (target < 0 || d > bestDot)
+				{
+					target = x;
+					bestDot = d;
+				}
+			}
+			x = onSeam(v) ? seamNext[x] : v;
+		} while (x != v);
 
-	// Vertex Positions
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-						  (GLvoid *)0);
-	// Vertex Normals
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-						  (GLvoid *)offsetof(Vertex, Normal));
-	// Vertex Texture Coords
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-						  (GLvoid *)offsetof(Vertex, TexCoords));
+		out.push_back({w, target, 0.0f});
+	}
+}
 
-	glBindVertexArray(0);
+bool Mesh::pinchesSeam(VertexID w, VertexID target) const
+{
+	if (!onSeam(target))
+		return false;
 
-	initCollapseQueue();
+	for (VertexID x = seamNext[target]; x != target; x = seamNext[x])
+		if (alive[x] && edgeFaces->count(w, x) > 0)
+			return true;
+	return false;
 }
 
-void Mesh::updateVBO()
+bool Mesh::isSeamEdge(VertexID u, VertexID v) const
 {
-	std::vector<GLuint> activeIndices;
+	if (!onSeam(u) && !onSeam(v))
+		return false;
 
-	for (auto &tri : triangles)
+	// another pair of wedges of the two points shares an edge
+	VertexID w = u;
+	do
 	{
-		// Only render if the triangle is not degenerate and all verts are alive
-		if (tri.isDegenerate())
+		VertexID x = v;
+		do
+		{
+			if ((w != u || x != v) && edgeFaces->count(w, x) > 0)
+				return true;
+			x = onSeam(v) ? seamNext[x] : v;
+		} while (x != v);
+		w = onSeam(u) ? seamNext[w] : u;
+	} while (w != u);
+	return false;
+}
+
+void Mesh::gatherNeighbors(VertexID u, std::vector<VertexID> &out) const
+{
+	out.clear();
+	for (TriangleID tid : vertTriangles[u])
+	{
+		const Triangle &t = triangles[tid];
+		if (t.isDegenerate())
 			continue;
 
-		bool allAlive = true;
-		for (int i = 0; i < 3; ++i)
+		for (VertexID n : t.verts)
+			if (n != u)
+				out.push_back(n);
+	}
+
+	// keep the first of each, in order. Valence is usually small and a
+	// linear scan beats any set, but a hub vertex would make that quadratic
+	const size_t kLinearScan = 64;
+	if (out.size() <= kLinearScan)
+	{
+		size_t kept = 0;
+		for (size_t i = 0; i < out.size(); ++i)
+			if (std::find(out.begin(), out.begin() + kept, out[i]) == out.begin() + kept)
+				out[kept++] = out[i];
+		out.resize(kept);
+		return;
+	}
+
+	std::vector<std::pair<VertexID, uint32_t>> first(out.size());
+	for (size_t i = 0; i < out.size(); ++i)
+		first[i] = {out[i], static_cast<uint32_t>(i)};
+	std::sort(first.begin(), first.end());
+	first.erase(std::unique(first.begin(), first.end(), [](const auto &a, const auto &b)
+							{ return a.first == b.first; }),
+				first.end());
+	std::sort(first.begin(), first.end(), [](const auto &a, const auto &b)
+			  { return a.second < b.second; });
+
+	out.resize(first.size());
+	for (size_t i = 0; i < first.size(); ++i)
+		out[i] = first[i].first;
+}
+
+void Mesh::initCollapseQueue()
+{
+	// every vertex's best neighbour is independent of the others, find them
+	// in parallel into a per-vertex slot, then compact in vertex order so
+	// the heap comes out the same whatever the thread count
+	std::vector<VertexCost> best(positions->size(), {-1, -1, 0.0f});
+	std::vector<VertexID> &dest = destiny.write();
+	dest.assign(positions->size(), -1);
+
+	JobSystem::global().parallelFor(0, positions->size(), 1024, [&](size_t first, size_t last)
+									{
+		std::vector<VertexID> ring;
+		for (size_t i = first; i < last; ++i)
 		{
-			if (!vertices[tri.verts[i]].alive)
+			VertexID u = static_cast<VertexID>(i);
+			if (!alive[u])
+				continue;
+
+			VertexCost c = bestCollapse(u, ring);
+			if (c.v != -1)
 			{
-				allAlive = false;
-				break;
+				dest[u] = c.v;
+				best[u] = c;
 			}
-		}
+		} });
 
-		if (allAlive)
-		{
-			activeIndices.push_back(tri.verts[0]);
-			activeIndices.push_back(tri.verts[1]);
-			activeIndices.push_back(tri.verts[2]);
-		}
-	}
+	std::vector<VertexCost> candidates;
+	candidates.reserve(positions->size());
+	for (const VertexCost &c : best)
+		if (c.u >= 0)
+			candidates.push_back(c);
+
+	// heapify everything at once rather than pushing one by one
+	collapseQueue.write().build(std::move(candidates), positions->size());
+}
 
-	this->indices = activeIndices;
+Mesh::~Mesh() = default;
 
-	// Update the existing EBO on the GPU
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->EBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint),
-				 indices.data(), GL_DYNAMIC_DRAW);
+int Mesh::NumVerts() const
+{
+	return aliveCount;
 }
 
-void Mesh::destroyGL()
+void Mesh::setAlive(VertexID u, bool state)
 {
-	if (VAO)
-		glDeleteVertexArrays(1, &VAO);
-	if (VBO)
-		glDeleteBuffers(1, &VBO);
-	if (EBO)
-		glDeleteBuffers(1, &EBO);
+	if (isAlive(u) == state)
+		return;
+
+	alive.write()[u] = state ? 1 : 0;
+	aliveCount += state ? 1 : -1;
 }
 
-void Mesh::Draw(GLuint programID, const glm::mat4 &MVP)
+// Only render if the triangle is not degenerate and all verts are alive
+bool Mesh::isDrawn(const Triangle &t) const
 {
-	// glm::mat4 MVP = ProjectionMatrix * ViewMatrix * ModelMatrix;
-	glUseProgram(programID);
-	GLint loc = glGetUniformLocation(programID, "u_mvp");
-	if (loc != -1)
-	{
-		glUniformMatrix4fv(loc, 1, GL_FALSE, &MVP[0][0]);
-	}
+	if (t.isDegenerate())
+		return false;
+
+	return alive[t.verts[0]] && alive[t.verts[1]] && alive[t.verts[2]];
+}
 
-	// update indices in here (probably) ====================================================================
-	for (int i = 0; i < 0; i++)
+void Mesh::updateIndices()
+{
+	StatScope timer(StatTimer::IndexUpdate);
+	const std::vector<Triangle> &tris = *triangles;
+	std::vector<unsigned int> activeIndices;
+	std::vector<int32_t> slotOf(tris.size(), -1);
+	std::vector<TriangleID> slotTri;
+
+	for (TriangleID tid = 0; tid < static_cast<TriangleID>(tris.size()); ++tid)
 	{
+		const Triangle &tri = tris[tid];
+		if (!isDrawn(tri))
+			continue;
+
+		slotOf[tid] = static_cast<int32_t>(slotTri.size());
+		slotTri.push_back(tid);
+		activeIndices.push_back(tri.verts[0]);
+		activeIndices.push_back(tri.verts[1]);
+		activeIndices.push_back(tri.verts[2]);
 	}
 
-	// Draw mesh
-	glBindVertexArray(this->VAO);
-	glDrawElements(GL_TRIANGLES, this->indices.size(), GL_UNSIGNED_INT, 0);
-	glBindVertexArray(0);
+	// fresh arrays, the old ones may still be shared
+	indices = Shared<std::vector<unsigned int>>(std::move(activeIndices));
+	triangleSlot = Shared<std::vector<int32_t>>(std::move(slotOf));
+	slotTriangle = Shared<std::vector<TriangleID>>(std::move(slotTri));
+
+	// everything changed, nobody can catch up from the log
+	indexLogBase = indexVersion() + 1;
+	indexLog.clear();
 }
 
-bool Mesh::isBoundaryEdge(VertexID u, VertexID v) const
+void Mesh::updateIndices(const pFace *changed, size_t count)
 {
-	int sharedCount = 0;
+	if (triangleSlot->size() != triangles->size())
+	{
+		updateIndices();
+		return;
+	}
+
+	std::vector<unsigned int> &idx = indices.write();
+	std::vector<int32_t> &slotOf = triangleSlot.write();
+	std::vector<TriangleID> &slotTri = slotTriangle.write();
 
-	// only need to check triangles attached to one of the vertices
-	for (TriangleID tid : vertices[u].triangles)
+	for (size_t i = 0; i < count; ++i)
 	{
+		TriangleID tid = changed[i].tri;
 		const Triangle &t = triangles[tid];
+		int32_t slot = slotOf[tid];
 
-		if (!t.isDegenerate() && t.contains(v))
+		if (isDrawn(t))
 		{
-			sharedCount++;
+			if (slot < 0)
+			{
+				slot = static_cast<int32_t>(slotTri.size());
+				slotOf[tid] = slot;
+				slotTri.push_back(tid);
+				idx.resize(idx.size() + 3);
+			}
+
+			std::copy(t.verts.begin(), t.verts.end(), idx.begin() + slot * 3);
+			logIndexSlot(slot);
 		}
+		else if (slot >= 0)
+		{
+			// the last triangle fills the hole so the list stays packed
+			int32_t last = static_cast<int32_t>(slotTri.size()) - 1;
+			if (slot != last)
+			{
+				TriangleID moved = slotTri[last];
+				slotTri[slot] = moved;
+				slotOf[moved] = slot;
+				std::copy(idx.begin() + last * 3, idx.begin() + last * 3 + 3, idx.begin() + slot * 3);
+				logIndexSlot(slot);
+			}
+
+			slotTri.pop_back();
+			idx.resize(idx.size() - 3);
+			slotOf[tid] = -1;
+		}
+	}
+}
+
+void Mesh::logIndexSlot(uint32_t slot)
+{
+	// past one write per slot a full upload is cheaper than the log, so
+	// stop keeping it and let readers that far behind start over
+	if (indexLog.size() >= slotTriangle->size() + 64)
+	{
+		indexLogBase += indexLog.size() + 1;
+		indexLog.clear();
 	}
+	indexLog.push_back(slot);
+}
+
+bool Mesh::indexChangesSince(uint64_t since, std::vector<uint32_t> &slots) const
+{
+	if (since < indexLogBase || since > indexVersion())
+		return false;
+
+	slots.assign(indexLog.begin() + (since - indexLogBase), indexLog.end());
+	return true;
+}
 
+size_t Mesh::memoryBytes() const
+{
+	auto bytes = [](const auto &v)
+	{ return v.capacity() * sizeof(v[0]); };
+
+	return bytes(*positions) + bytes(*normals) + bytes(*texCoords) +
+		   collapseQueue->memoryBytes() + bytes(*quadrics) + vertTriangles->memoryBytes() +
+		   edgeFaces->memoryBytes() + bytes(*destiny) + bytes(*facePlanes) + bytes(*seamNext) +
+		   bytes(*alive) + bytes(*triangles) + bytes(*indices) + bytes(*triangleSlot) +
+		   bytes(*slotTriangle) + bytes(indexLog) + bytes(regionStamp);
+}
+
+EdgeKind Mesh::classifyEdge(VertexID u, VertexID v) const
+{
 	/*standard manifold mesh:
 		sharedCount == 2: interior edge
 		sharedCount == 1: boundary
 		sharedCount > 2: very bad for simplification
 	*/
+	switch (edgeFaces->count(u, v))
+	{
+	case 0:
+		return EdgeKind::None;
+	case 1:
+		return EdgeKind::Boundary;
+	case 2:
+		return EdgeKind::Interior;
+	default:
+		return EdgeKind::NonManifold;
+	}
+}
+
+// keep the edge face counts in step with a triangle appearing or vanishing
+void Mesh::countEdges(const std::array<VertexID, 3> &verts, int delta)
+{
+	if (verts[0] == verts[1] || verts[1] == verts[2] || verts[2] == verts[0])
+		return;
 
-	return sharedCount == 1;
+	EdgeTable &edges = edgeFaces.write();
+	edges.add(verts[0], verts[1], delta);
+	edges.add(verts[1], verts[2], delta);
+	edges.add(verts[2], verts[0], delta);
 }
 
 // =====================================================edge collapse and vertex split
 
-void Mesh::edgeCollapse(VertexID u, VertexID v)
+CollapseRecord Mesh::edgeCollapse(VertexID u, VertexID v, std::vector<pFace> *changes)
 {
-	if (!vertices[u].alive || !vertices[v].alive)
-		return;
+	ensureSimplification();
+
+	CollapseRecord record{u, v, 0, 0, positions[v], quadrics[v]};
+	if (!alive[u] || !alive[v])
+		return record;
 
-	vertices[u].alive = false;
+	// u's ring has to be read before its triangles are renamed
+	std::vector<VertexID> affected;
+	gatherNeighbors(u, affected);
+
+	alive.write()[u] = false;
 	aliveCount--;
+	collapseQueue.write().erase(u);
 
-	for (TriangleID tid : vertices[u].triangles)
-	{
-		Triangle &t = triangles[tid];
-		if (t.contains(v))
-			t.verts = {u, u, u};
-		else
-			t.replace(u, v);
-	}
+	std::vector<pFace> local;
+	std::vector<pFace> &out = changes ? *changes : local;
+	size_t first = out.size();
+	collapseLocal(u, v, out);
 
-	// update neighbors
-	std::vector<VertexID> affected;
-	affected.push_back(v);
-	for (VertexID n : vertices[u].neighbors)
-	{
-		auto &nbrs = vertices[n].neighbors;
-		nbrs.erase(std::remove(nbrs.begin(), nbrs.end(), u), nbrs.end());
+	record.facesBegin = static_cast<uint32_t>(first);
+	record.faceCount = static_cast<uint32_t>(out.size() - first);
 
-		if (n != v &&
-			std::find(vertices[v].neighbors.begin(), vertices[v].neighbors.end(), n) == vertices[v].neighbors.end())
-		{
-			vertices[v].neighbors.push_back(n);
-		}
-		affected.push_back(n);
+	for (size_t i = first; i < out.size(); ++i)
+	{
+		countEdges(out[i].before, -1);
+		countEdges(triangles[out[i].tri].verts, +1);
 	}
 
+	// v moved and its quadric grew, so every edge around it is re-priced,
+	// not only the ones it inherited from u. Seam wedges price their
+	// siblings' collapses too, so that is the ring of every wedge of v's point
+	if (placement == Placement::Optimal)
+		addPointRings(v, affected);
+	// v itself, which u's ring misses when a seam wedge goes onto a target
+	// it shares no edge with
+	else if (std::find(affected.begin(), affected.end(), v) == affected.end())
+		affected.push_back(v);
+	addSeamSiblings(affected);
+
 	for (VertexID id : affected)
 	{
 		updateVertexCost(id);
 	}
 
-	vertices[u].neighbors.clear();
+	return record;
 }
 
-void Mesh::vertexSplit(VertexID u, VertexID v)
+// the part of a collapse that only touches u, v and u's ring: v's position
+// and quadric, u's triangles and the incidence slices of their corners.
+// Runs in parallel for collapseIndependent, which unshares what it writes
+void Mesh::collapseLocal(VertexID u, VertexID v, std::vector<pFace> &changes)
 {
-	if (u < 0 || v < 0)
-		return;
+	// v takes over u's planes so later collapses still see the error
+	// measured against the original surface
+	if (placement == Placement::Optimal)
+	{
+		glm::vec3 p = collapsePosition(u, v);
+		positions.write()[v] = p;
+		quadrics.write()[v] += quadrics[u];
+	}
 
-	vertices[u].alive = true;
-	aliveCount++;
+	IncidenceTable &incidence = vertTriangles.write();
+	std::vector<Triangle> &tris = triangles.write();
+
+	// copied, growing v's slice may move the shared array
+	auto around = incidence[u];
+	std::vector<TriangleID> uTriangles(around.begin(), around.end());
 
-	for (TriangleID tid : vertices[u].triangles)
+	for (TriangleID tid : uTriangles)
 	{
-		Triangle &t = triangles[tid];
+		Triangle &t = tris[tid];
+		std::array<VertexID, 3> before = t.verts;
+		t.collapse(u, v);
 
-		if (t.isDegenerate())
+		if (t.verts == before)
+			continue;
+		changes.push_back({tid, before});
+
+		if (!t.isDegenerate())
 		{
-			t.verts = t.originalVerts;
+			// renamed triangles now belong to v, or a later collapse of v
+			// would leave them pointing at a dead vertex
+			incidence.add(v, tid);
 		}
 		else
 		{
-			t.replace(v, u);
+			// the triangle on the edge is gone, drop it from its other corners.
+			// u keeps its list so the collapse can still be undone
+			for (VertexID c : before)
+				if (c != u)
+					incidence.remove(c, tid);
 		}
 	}
 }
 
-void Mesh::updateVertexCost(VertexID u)
+void Mesh::vertexSplit(const CollapseRecord &record, const std::vector<pFace> &changes)
 {
-	if (!vertices[u].alive)
+	VertexID u = record.u;
+	VertexID v = record.v;
+	if (alive[u])
 		return;
 
-	float minCost = std::numeric_limits<float>::max();
-	VertexID bestV = -1;
+	alive.write()[u] = true;
+	aliveCount++;
+	positions.write()[v] = record.vPosition;
+	quadrics.write()[v] = record.vQuadric;
+	IncidenceTable &incidence = vertTriangles.write();
+	std::vector<Triangle> &tris = triangles.write();
+
+	// splits run in reverse collapse order, so every triangle is exactly as
+	// this collapse left it
+	for (uint32_t i = record.faceCount; i-- > 0;)
+	{
+		const pFace &f = changes[record.facesBegin + i];
+		Triangle &t = tris[f.tri];
+		countEdges(t.verts, -1);
 
-	for (VertexID v : vertices[u].neighbors)
+		if (t.isDegenerate())
+		{
+			for (VertexID c : f.before)
+				if (c != u)
+					incidence.add(c, f.tri);
+		}
+		else
+		{
+			incidence.remove(v, f.tri);
+		}
+
+		t.verts = f.before;
+		countEdges(t.verts, +1);
+	}
+
+	// every cost the collapse changed lies in the rings of u's and v's
+	// points (u's siblings choose their targets among the live wedges),
+	// re-pricing them restores the queue as it was
+	std::vector<VertexID> affected;
+	addPointRings(u, affected);
+	addPointRings(v, affected);
+	addSeamSiblings(affected);
+
+	for (VertexID id : affected)
+		updateVertexCost(id);
+}
+
+// cheapest collapse of u onto a live neighbour, v = -1 when there is none.
+// ring is scratch space, passed in so callers can reuse it
+VertexCost Mesh::bestCollapse(VertexID u, std::vector<VertexID> &ring) const
+{
+	VertexCost best{u, -1, std::numeric_limits<float>::max()};
+	uint64_t evaluated = 0;
+	const bool seam = onSeam(u);
+	std::vector<VertexCost> siblings;
+
+	gatherNeighbors(u, ring);
+	for (VertexID v : ring)
 	{
-		if (!vertices[v].alive)
+		if (!alive[v] || (seam && samePoint(u, v)) || pinchesSeam(u, v))
 			continue;
 
+		++evaluated;
+		// ties go to the lower id, so the answer doesn't depend on the
+		// order of u's slice, which splits don't preserve
 		float c = Cost(u, v, *this);
-		if (c < minCost)
+		if (seam)
+		{
+			// every wedge, each with the quadric of its own side
+			seamSiblings(u, v, siblings);
+			bool pinches = false;
+			for (const VertexCost &s : siblings)
+			{
+				c += Cost(s.u, s.v, *this);
+				pinches |= pinchesSeam(s.u, s.v);
+			}
+			evaluated += siblings.size();
+			if (pinches)
+				continue;
+		}
+		if (c < best.cost || (c == best.cost && v < best.v))
 		{
-			minCost = c;
-			bestV = v;
+			best.cost = c;
+			best.v = v;
 		}
 	}
 
-	if (bestV != -1)
+	statAdd(Stat::CostEvaluations, evaluated);
+	return best;
+}
+
+void Mesh::updateVertexCost(VertexID u)
+{
+	CollapseHeap &queue = collapseQueue.write();
+	if (!alive[u])
 	{
-		vertices[u].destiny = bestV;
-		// We push a new entry. The priority queue will handle the sorting.
-		// The cheapestVertex() function already handles skipping "stale" entries
-		// by checking if .alive is true.
-		collapseQueue.push({u, bestV, minCost});
+		queue.erase(u);
+		return;
 	}
+
+	std::vector<VertexID> ring;
+	VertexCost best = bestCollapse(u, ring);
+
+	destiny.write()[u] = best.v;
+	if (best.v != -1)
+		queue.update(best); // moves u's entry in place
+	else
+		queue.erase(u);
+}
+
+// plane equation ax + by + cz + d = 0 of every triangle, computed once
+void Mesh::computeFacePlanes()
+{
+	std::vector<glm::vec4> &planes = facePlanes.write();
+	planes.resize(triangles->size());
+
+	JobSystem::global().parallelFor(0, triangles->size(), 4096, [&](size_t first, size_t last)
+									{
+		for (size_t tid = first; tid < last; ++tid)
+		{
+			const Triangle &t = triangles[tid];
+			glm::vec3 n = t.getNormal(*this);
+			float d = -glm::dot(n, positions[t.verts[0]]);
+			planes[tid] = glm::vec4(n.x, n.y, n.z, d);
+		} });
 }
 
+// needs computeFacePlanes and the adjacency
 void Mesh::computeInitialQuadrics()
 {
-	// initialize Q for a vertex based on its neighbor triangles
-	for (auto &v : vertices)
+	std::vector<Quadric> &Qs = quadrics.write();
+	Qs.assign(positions->size(), Quadric());
+
+	// each vertex gathers the fundamental quadrics of its own triangles, so
+	// vertices can be summed in parallel. The incidence lists are in
+	// triangle order, which keeps the float sums the same on any thread count
+	JobSystem::global().parallelFor(0, positions->size(), 2048, [&](size_t first, size_t last)
+									{
+		for (size_t u = first; u < last; ++u)
+		{
+			Quadric Q;
+			for (TriangleID tid : vertTriangles[u])
+				Q += Quadric(facePlanes[tid]);
+			Qs[u] = Q;
+		} });
+}
+
+void Mesh::setPlacement(Placement p)
+{
+	if (placement == p)
+		return;
+
+	placement = p;
+	if (!quadrics->empty())
+		initCollapseQueue();
+}
+
+glm::vec3 Mesh::collapsePosition(VertexID u, VertexID v) const
+{
+	// wedges of one point have to stay together, none of them moves
+	if (placement == Placement::Endpoint || onSeam(u) || onSeam(v))
+		return positions[v];
+
+	Quadric Q = quadrics[u] + quadrics[v];
+	glm::vec3 best;
+	if (Q.minimizer(best))
+		return best;
+
+	// ill-conditioned, settle for the cheapest of the endpoints and midpoint
+	const glm::vec3 candidates[3] = {positions[v], positions[u], (positions[u] + positions[v]) * 0.5f};
+	float bestError = std::numeric_limits<float>::max();
+	for (const glm::vec3 &p : candidates)
 	{
-		v.Q = glm::mat4(0.0f);
-		for (TriangleID tid : v.triangles)
+		float e = Q.evaluate(p);
+		if (e < bestError)
 		{
-			Triangle &t = triangles[tid];
-			// calculate plane equation: ax + by + cz + d = 0
-			glm::vec3 n = t.getNormal(*this);
-			float d = -glm::dot(n, vertices[t.verts[0]].Position);
-
-			// Fundamental error quadric for this plane
-			float a = n.x, b = n.y, c = n.z;
-			glm::mat4 K(
-				a * a, a * b, a * c, a * d,
-				a * b, b * b, b * c, b * d,
-				a * c, b * c, c * c, c * d,
-				a * d, b * d, c * d, d * d);
-			v.Q += K;
+			bestError = e;
+			best = p;
 		}
 	}
+	return best;
 }
 
 // get the cheapest edge
 VertexID Mesh::cheapestVertex()
 {
-	while (!collapseQueue.empty())
-	{
-		VertexCost top = collapseQueue.top();
-		collapseQueue.pop();
+	ensureSimplification();
+	CollapseHeap &queue = collapseQueue.write();
 
-		if (!vertices[top.u].alive || !vertices[top.v].alive)
-			continue;
+	// entries are kept current, the checks only guard against callers that
+	// changed liveness behind the queue's back
+	while (!queue.empty())
+	{
+		VertexCost top = queue.pop();
 
-		// if we find cheaper destiny, skip
-		if (vertices[top.u].destiny != top.v)
+		if (!alive[top.u] || !alive[top.v] || destiny[top.u] != top.v)
+		{
+			statAdd(Stat::StalePops);
 			continue;
+		}
 
 		return top.u;
 	}
 	return -1;
 }
+
+// starts a new round of region stamps, clearing them when the counter wraps
+uint32_t Mesh::nextRegionRound()
+{
+	regionStamp.resize(positions->size(), 0);
+	if (++regionRound == 0)
+	{
+		std::fill(regionStamp.begin(), regionStamp.end(), 0);
+		regionRound = 1;
+	}
+	return regionRound;
+}
+
+std::vector<VertexCost> Mesh::selectIndependentCollapses(size_t window, size_t maxCollapses)
+{
+	ensureSimplification();
+	CollapseHeap &queue = collapseQueue.write();
+
+	std::vector<VertexCost> selected;
+	std::vector<VertexCost> rejected, siblings;
+	std::vector<VertexID> region, ring;
+	uint32_t round = nextRegionRound();
+
+	for (size_t popped = 0; popped < window && selected.size() < maxCollapses && !queue.empty(); ++popped)
+	{
+		VertexCost c = queue.pop();
+		if (!alive[c.u] || !alive[c.v] || destiny[c.u] != c.v)
+		{
+			statAdd(Stat::StalePops);
+			continue;
+		}
+
+		// everything the collapse writes or prices against: both endpoints
+		// and their rings, for a seam collapse its siblings' as well
+		seamSiblings(c.u, c.v, siblings);
+		gatherNeighbors(c.u, region);
+		region.push_back(c.u);
+		auto add = [&](VertexID x)
+		{
+			gatherNeighbors(x, ring);
+			region.insert(region.end(), ring.begin(), ring.end());
+			region.push_back(x);
+		};
+		add(c.v);
+		for (const VertexCost &s : siblings)
+		{
+			add(s.u);
+			add(s.v);
+		}
+
+		bool free = std::none_of(region.begin(), region.end(), [&](VertexID x)
+								 { return regionStamp[x] == round; });
+		if (!free || selected.size() + 1 + siblings.size() > maxCollapses)
+		{
+			rejected.push_back(c);
+			continue;
+		}
+
+		for (VertexID x : region)
+			regionStamp[x] = round;
+		selected.push_back(c);
+		for (const VertexCost &s : siblings)
+			selected.push_back({s.u, s.v, c.cost});
+	}
+
+	// still valid, nothing they depend on has changed yet
+	for (const VertexCost &c : rejected)
+		queue.update(c);
+
+	return selected;
+}
+
+void Mesh::collapseIndependent(const std::vector<VertexCost> &batch, std::vector<std::vector<pFace>> &changes)
+{
+	JobSystem &jobs = JobSystem::global();
+	size_t n = batch.size();
+
+	changes.resize(n);
+	std::vector<std::vector<VertexID>> rings(n);
+
+	// rings are read before any triangle is renamed
+	jobs.parallelFor(0, n, 64, [&](size_t first, size_t last)
+					 {
+		for (size_t i = first; i < last; ++i)
+		{
+			gatherNeighbors(batch[i].u, rings[i]);
+			// v too, a seam wedge's target need not be in u's ring
+			rings[i].push_back(batch[i].v);
+			changes[i].clear();
+		} });
+
+	// the shared state: liveness, the queue and slice growth, which may move
+	// or compact the incidence array. Unsharing happens here too, collapseLocal
+	// must find its arrays already private
+	CollapseHeap &queue = collapseQueue.write();
+	IncidenceTable &incidence = vertTriangles.write();
+	std::vector<uint8_t> &live = alive.write();
+	triangles.write();
+	if (placement == Placement::Optimal)
+	{
+		positions.write();
+		quadrics.write();
+	}
+
+	// the wedges of one point are one group: several of them can go onto
+	// the same vertex and share triangles around it
+	std::vector<size_t> groups;
+	for (size_t i = 0; i < n; ++i)
+		if (i == 0 || !samePoint(batch[groups.back()].u, batch[i].u))
+			groups.push_back(i);
+	groups.push_back(n);
+
+	for (size_t g = 0; g + 1 < groups.size(); ++g)
+		for (size_t i = groups[g]; i < groups[g + 1]; ++i)
+		{
+			const VertexCost &c = batch[i];
+			live[c.u] = false;
+			aliveCount--;
+			queue.erase(c.u);
+
+			// room for every wedge of the group with the same target
+			uint32_t grows = 0;
+			for (size_t j = groups[g]; j <= i; ++j)
+				if (batch[j].v == c.v)
+					grows += static_cast<uint32_t>(incidence[batch[j].u].size());
+			incidence.reserve(c.v, grows);
+		}
+
+	// regions are disjoint, so each group only writes its own vertices,
+	// triangles and slices
+	jobs.parallelFor(0, groups.size() - 1, 16, [&](size_t first, size_t last)
+					 {
+		for (size_t g = first; g < last; ++g)
+			for (size_t i = groups[g]; i < groups[g + 1]; ++i)
+				collapseLocal(batch[i].u, batch[i].v, changes[i]); });
+
+	for (size_t i = 0; i < n; ++i)
+		for (const pFace &f : changes[i])
+		{
+			countEdges(f.before, -1);
+			countEdges(triangles[f.tri].verts, +1);
+		}
+
+	// as in edgeCollapse, an optimal collapse re-prices the rings of v's point
+	if (placement == Placement::Optimal)
+	{
+		jobs.parallelFor(0, n, 64, [&](size_t first, size_t last)
+						 {
+			for (size_t i = first; i < last; ++i)
+				addPointRings(batch[i].v, rings[i]); });
+	}
+
+	std::vector<VertexID> affected;
+	uint32_t round = nextRegionRound();
+	auto affect = [&](VertexID x)
+	{
+		if (regionStamp[x] != round)
+		{
+			regionStamp[x] = round;
+			affected.push_back(x);
+		}
+	};
+	for (const auto &r : rings)
+		for (VertexID x : r)
+		{
+			affect(x);
+			if (onSeam(x))
+				for (VertexID w = seamNext[x]; w != x; w = seamNext[w])
+					affect(w);
+		}
+
+	std::vector<VertexCost> costs(affected.size());
+	jobs.parallelFor(0, affected.size(), 256, [&](size_t first, size_t last)
+					 {
+		std::vector<VertexID> ring;
+		for (size_t i = first; i < last; ++i)
+		{
+			VertexID u = affected[i];
+			costs[i] = alive[u] ? bestCollapse(u, ring) : VertexCost{u, -1, 0.0f};
+		} });
+
+	std::vector<VertexID> &dest = destiny.write();
+	for (const VertexCost &c : costs)
+	{
+		if (!alive[c.u])
+		{
+			queue.erase(c.u);
+			continue;
+		}
+
+		dest[c.u] = c.v;
+		if (c.v != -1)
+			queue.update(c);
+		else
+			queue.erase(c.u);
+	}
+}
@@ -0,0 +1,440 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "mesh/ViewRefiner.h"
+
+namespace
+{
+	const float kPi = 3.14159265f;
+
+	// normals within `angle` of `axis`; a negative angle holds none yet
+	struct Cone
+	{
+		glm::vec3 axis{0.0f, 0.0f, 1.0f};
+		float angle = -1.0f;
+	};
+
+	// smallest cone holding both
+	Cone mergeCones(const Cone &a, const Cone &b)
+	{
+		if (a.angle < 0.0f)
+			return b;
+		if (b.angle < 0.0f)
+			return a;
+
+		float between = std::acos(std::clamp(glm::dot(a.axis, b.axis), -1.0f, 1.0f));
+		if (between + b.angle <= a.angle)
+			return a;
+		if (between + a.angle <= b.angle)
+			return b;
+
+		float angle = 0.5f * (between + a.angle + b.angle);
+		if (angle >= kPi)
+			return {a.axis, kPi};
+
+		// turn a's axis towards b's until the new cone touches both
+		glm::vec3 side = b.axis - a.axis * glm::dot(a.axis, b.axis);
+		float sideLength = glm::length(side);
+		if (sideLength < 1e-8f)
+			return {a.axis, angle};
+		float turn = angle - a.angle;
+		return {glm::normalize(a.axis * std::cos(turn) + side / sideLength * std::sin(turn)), angle};
+	}
+
+	Cone addNormal(const Cone &c, const glm::vec3 &n)
+	{
+		float length = glm::length(n);
+		if (length < 1e-12f)
+			return c;
+		return mergeCones(c, {n / length, 0.0f});
+	}
+
+	glm::vec3 faceNormal(const std::vector<glm::vec3> &pos, const std::array<VertexID, 3> &v)
+	{
+		return glm::cross(pos[v[1]] - pos[v[0]], pos[v[2]] - pos[v[0]]);
+	}
+
+	glm::vec4 row(const glm::mat4 &m, int i)
+	{
+		return glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+	}
+}
+
+// per update, what the tests need from the view
+struct ViewRefiner::Frame
+{
+	explicit Frame(const ViewParams &view)
+	{
+		glm::vec4 r0 = row(view.mvp, 0), r1 = row(view.mvp, 1), r2 = row(view.mvp, 2), r3 = row(view.mvp, 3);
+		glm::vec4 raw[6] = {r3 + r0, r3 - r0, r3 + r1, r3 - r1, r3 + r2, r3 - r2};
+		for (int i = 0; i < 6; ++i)
+		{
+			float length = glm::length(glm::vec3(raw[i]));
+			planes[i] = length > 0.0f ? raw[i] / length : raw[i];
+		}
+
+		depthRow = r3;
+		depthSlope = glm::length(glm::vec3(r3));
+		pixelsPerUnit = glm::length(glm::vec3(r1)) * view.viewportHeight * 0.5f;
+		pixelError = std::max(view.pixelError, 1e-3f);
+
+		// the eye is the point clip space sends to (0, 0, z, 0)
+		glm::vec4 h = glm::inverse(view.mvp) * glm::vec4(0.0f, 0.0f, 1.0f, 0.0f);
+		cullBackfaces = view.cullBackfaces && std::abs(h.w) > 1e-12f;
+		if (cullBackfaces)
+			eye = glm::vec3(h) / h.w;
+	}
+
+	glm::vec4 planes[6];
+	glm::vec4 depthRow;
+	float depthSlope;
+	float pixelsPerUnit;
+	float pixelError;
+	bool cullBackfaces;
+	glm::vec3 eye{0.0f};
+};
+
+ViewRefiner::ViewRefiner(const pMesh &pm)
+	: history(pm.History()),
+	  faces(pm.Faces()),
+	  moves(pm.Moves())
+{
+	std::vector<Triangle> tris = pm.Current().getTriangles();
+	for (Triangle &t : tris)
+		t.verts = t.originalVerts;
+	mesh = std::make_unique<Mesh>(pm.OriginalVertices(), std::move(tris));
+
+	buildHierarchy();
+
+	for (int i = 0; i < static_cast<int>(history.size()); ++i)
+		collapse(i);
+	verticesDirty = false;
+}
+
+void ViewRefiner::buildHierarchy()
+{
+	const int vertexCount = mesh->TotalVerts();
+	const size_t triangleCount = mesh->getTriangles().size();
+	const int steps = static_cast<int>(history.size());
+
+	// collapses into each vertex and the one removing it
+	mergeBegin.assign(vertexCount + 1, 0);
+	removedBy.assign(vertexCount, -1);
+	for (int i = 0; i < steps; ++i)
+	{
+		mergeBegin[history[i].to + 1]++;
+		removedBy[history[i].from] = i;
+	}
+	for (int v = 0; v < vertexCount; ++v)
+		mergeBegin[v + 1] += mergeBegin[v];
+	merges.resize(steps);
+	mergeIndex.resize(steps);
+	{
+		std::vector<uint32_t> fill(mergeBegin.begin(), mergeBegin.end() - 1);
+		for (int i = 0; i < steps; ++i)
+		{
+			VertexID v = history[i].to;
+			mergeIndex[i] = fill[v] - mergeBegin[v];
+			merges[fill[v]++] = i;
+		}
+	}
+	merged.assign(vertexCount, 0);
+
+	// collapses touching each triangle
+	touchBegin.assign(triangleCount + 1, 0);
+	for (const pFace &f : faces)
+		touchBegin[f.tri + 1]++;
+	for (size_t t = 0; t < triangleCount; ++t)
+		touchBegin[t + 1] += touchBegin[t];
+	touches.resize(faces.size());
+	touchIndex.resize(faces.size());
+	{
+		std::vector<uint32_t> fill(touchBegin.begin(), touchBegin.end() - 1);
+		for (int i = 0; i < steps; ++i)
+			for (uint32_t k = history[i].facesBegin; k < history[i].facesBegin + history[i].faceCount; ++k)
+			{
+				TriangleID t = faces[k].tri;
+				touchIndex[k] = fill[t] - touchBegin[t];
+				touches[fill[t]++] = i;
+			}
+	}
+	touched.assign(triangleCount, 0);
+
+	// bounds, replaying the history on scratch copies from full resolution
+	std::vector<glm::vec3> pos = mesh->getPositions();
+	std::vector<Triangle> tris = mesh->getTriangles();
+
+	std::vector<vdNode> current(vertexCount);
+	std::vector<Cone> cones(vertexCount);
+	for (VertexID v = 0; v < vertexCount; ++v)
+		current[v] = {pos[v], 0.0f, glm::vec3(0.0f, 0.0f, 1.0f), -1.0f, 0.0f};
+	for (const Triangle &t : tris)
+	{
+		if (t.isDegenerate())
+			continue;
+		glm::vec3 n = faceNormal(pos, t.verts);
+		for (VertexID v : t.verts)
+			cones[v] = addNormal(cones[v], n);
+	}
+
+	std::vector<std::vector<TriangleID>> goneLists(steps);
+	nodes.resize(steps);
+	for (int i = 0; i < steps; ++i)
+	{
+		const pVert &h = history[i];
+		glm::vec3 fromPos = pos[h.from];
+		glm::vec3 toPos = pos[h.to];
+
+		Cone cone = mergeCones(cones[h.from], cones[h.to]);
+		for (uint32_t k = h.facesBegin; k < h.facesBegin + h.faceCount; ++k)
+			cone = addNormal(cone, faceNormal(pos, tris[faces[k].tri].verts));
+
+		for (uint32_t k = h.facesBegin; k < h.facesBegin + h.faceCount; ++k)
+		{
+			Triangle &t = tris[faces[k].tri];
+			t.collapse(h.from, h.to);
+			// a triangle removed here drops out of its other vertices'
+			// neighbourhoods, so collapsing those needs it gone
+			if (t.isDegenerate())
+				for (VertexID c : faces[k].before)
+					if (c != h.from && removedBy[c] >= 0)
+						goneLists[removedBy[c]].push_back(faces[k].tri);
+		}
+		if (!moves.empty())
+			pos[h.to] = moves[i].after;
+
+		// how far the two old vertices ended up from the faces now around them
+		float deviation = 0.0f;
+		for (uint32_t k = h.facesBegin; k < h.facesBegin + h.faceCount; ++k)
+		{
+			const Triangle &t = tris[faces[k].tri];
+			if (t.isDegenerate())
+				continue;
+			glm::vec3 n = faceNormal(pos, t.verts);
+			float length = glm::length(n);
+			if (length < 1e-12f)
+				continue;
+			n /= length;
+			cone = addNormal(cone, n);
+			const glm::vec3 &a = pos[t.verts[0]];
+			deviation = std::max({deviation, std::abs(glm::dot(n, fromPos - a)), std::abs(glm::dot(n, toPos - a))});
+		}
+
+		const vdNode &a = current[h.to];
+		const vdNode &b = current[h.from];
+		vdNode node;
+		node.center = pos[h.to];
+		node.radius = std::max(glm::length(node.center - a.center) + a.radius,
+							   glm::length(node.center - b.center) + b.radius);
+		node.coneAxis = cone.axis;
+		node.coneAngle = cone.angle < 0.0f ? kPi : cone.angle;
+		node.error = std::max(a.error, b.error) + deviation;
+
+		nodes[i] = node;
+		current[h.to] = node;
+		cones[h.to] = cone;
+	}
+
+	goneBegin.assign(steps + 1, 0);
+	gone.clear();
+	for (int i = 0; i < steps; ++i)
+	{
+		std::sort(goneLists[i].begin(), goneLists[i].end());
+		goneLists[i].erase(std::unique(goneLists[i].begin(), goneLists[i].end()), goneLists[i].end());
+		gone.insert(gone.end(), goneLists[i].begin(), goneLists[i].end());
+		goneBegin[i + 1] = static_cast<uint32_t>(gone.size());
+	}
+}
+
+int ViewRefiner::nodeOf(VertexID v) const
+{
+	return merged[v] > 0 ? merges[mergeBegin[v] + merged[v] - 1] : -1;
+}
+
+int ViewRefiner::parentOf(VertexID v) const
+{
+	if (mergeBegin[v] + merged[v] < mergeBegin[v + 1])
+		return merges[mergeBegin[v] + merged[v]];
+	return removedBy[v];
+}
+
+bool ViewRefiner::wantsSplit(int step, const Frame &frame) const
+{
+	const vdNode &node = nodes[step];
+
+	for (const glm::vec4 &p : frame.planes)
+		if (glm::dot(glm::vec3(p), node.center) + p.w < -node.radius)
+			return false;
+
+	if (frame.cullBackfaces)
+	{
+		// every normal in the cone points away from every point of the sphere
+		glm::vec3 d = node.center - frame.eye;
+		float distance = glm::length(d);
+		if (distance > node.radius)
+		{
+			float facing = std::acos(std::clamp(glm::dot(node.coneAxis, d / distance), -1.0f, 1.0f));
+			float spread = std::asin(node.radius / distance);
+			if (facing - node.coneAngle - spread > 0.5f * kPi)
+				return false;
+		}
+	}
+
+	// the error seen at the nearest depth the node reaches
+	float w = glm::dot(frame.depthRow, glm::vec4(node.center, 1.0f)) - node.radius * frame.depthSlope;
+	if (w <= 1e-6f)
+		return true;
+	return node.error * frame.pixelsPerUnit > frame.pixelError * w;
+}
+
+bool ViewRefiner::canCollapse(int step) const
+{
+	const pVert &h = history[step];
+	if (!mesh->isAlive(h.from) || !mesh->isAlive(h.to))
+		return false;
+	if (merged[h.to] != mergeIndex[step] || mergeBegin[h.from] + merged[h.from] != mergeBegin[h.from + 1])
+		return false;
+	for (uint32_t k = h.facesBegin; k < h.facesBegin + h.faceCount; ++k)
+		if (touched[faces[k].tri] != touchIndex[k])
+			return false;
+	// every collapse touching these has run, the last one removed them
+	for (uint32_t g = goneBegin[step]; g < goneBegin[step + 1]; ++g)
+		if (touchBegin[gone[g]] + touched[gone[g]] != touchBegin[gone[g] + 1])
+			return false;
+	return true;
+}
+
+int ViewRefiner::splitBlocker(int step) const
+{
+	const pVert &h = history[step];
+	if (mesh->isAlive(h.from))
+		return -2;
+	if (!mesh->isAlive(h.to))
+		return removedBy[h.to];
+	if (merged[h.to] != mergeIndex[step] + 1)
+		return merged[h.to] > mergeIndex[step] + 1 ? nodeOf(h.to) : -2;
+	for (uint32_t k = h.facesBegin; k < h.facesBegin + h.faceCount; ++k)
+	{
+		TriangleID t = faces[k].tri;
+		if (touched[t] != touchIndex[k] + 1)
+			return touched[t] > touchIndex[k] + 1 ? touches[touchBegin[t] + touched[t] - 1] : -2;
+		// the triangles coming back need their other corners live
+		for (VertexID c : faces[k].before)
+			if (c != h.from && !mesh->isAlive(c))
+				return removedBy[c];
+	}
+	return -1;
+}
+
+// every blocker comes later in the history than the step it blocks, so
+// the stack only grows towards the end and always runs out
+int ViewRefiner::forceSplit(int step)
+{
+	int splits = 0;
+	splitStack.assign(1, step);
+	while (!splitStack.empty())
+	{
+		int blocker = splitBlocker(splitStack.back());
+		if (blocker == -2)
+			break;
+		if (blocker >= 0)
+		{
+			splitStack.push_back(blocker);
+			continue;
+		}
+		split(splitStack.back());
+		splitStack.pop_back();
+		++splits;
+	}
+	return splits;
+}
+
+void ViewRefiner::collapse(int step)
+{
+	const pVert &h = history[step];
+	auto &tris = mesh->getTriangles();
+	for (uint32_t k = h.facesBegin; k < h.facesBegin + h.faceCount; ++k)
+	{
+		tris[faces[k].tri].collapse(h.from, h.to);
+		touched[faces[k].tri]++;
+	}
+	merged[h.to]++;
+
+	mesh->setAlive(h.from, false);
+	if (!moves.empty())
+	{
+		mesh->setPosition(h.to, moves[step].after);
+		verticesDirty = true;
+	}
+
+	if (h.faceCount > 0)
+		mesh->updateIndices(&faces[h.facesBegin], h.faceCount);
+}
+
+void ViewRefiner::split(int step)
+{
+	const pVert &h = history[step];
+	auto &tris = mesh->getTriangles();
+	for (uint32_t k = h.facesBegin; k < h.facesBegin + h.faceCount; ++k)
+	{
+		tris[faces[k].tri].verts = faces[k].before;
+		touched[faces[k].tri]--;
+	}
+	merged[h.to]--;
+
+	mesh->setAlive(h.from, true);
+	if (!moves.empty())
+	{
+		mesh->setPosition(h.to, moves[step].before);
+		verticesDirty = true;
+	}
+
+	if (h.faceCount > 0)
+		mesh->updateIndices(&faces[h.facesBegin], h.faceCount);
+}
+
+int ViewRefiner::update(const ViewParams &view)
+{
+	using Clock = std::chrono::steady_clock;
+	const auto start = Clock::now();
+	const Frame frame(view);
+	const VertexID total = mesh->TotalVerts();
+
+	int changes = 0;
+	for (VertexID visited = 0; visited < total; ++visited)
+	{
+		if ((visited & 15) == 15 && view.budgetMs > 0.0 &&
+			std::chrono::duration<double, std::milli>(Clock::now() - start).count() > view.budgetMs)
+			break;
+
+		VertexID v = cursor;
+		cursor = cursor + 1 < total ? cursor + 1 : 0;
+		if (!mesh->isAlive(v))
+			continue;
+
+		// split v's node as far as the view asks; the vertices it brings
+		// back are handled when the cursor reaches them
+		int node = nodeOf(v);
+		if (node >= 0 && wantsSplit(node, frame))
+		{
+			do
+			{
+				changes += forceSplit(node);
+				if (nodeOf(v) == node)
+					break;
+				node = nodeOf(v);
+			} while (node >= 0 && wantsSplit(node, frame));
+			continue;
+		}
+
+		// otherwise merge it back once its parent is no longer needed
+		int parent = parentOf(v);
+		if (parent >= 0 && canCollapse(parent) && !wantsSplit(parent, frame))
+		{
+			collapse(parent);
+			++changes;
+		}
+	}
+	return changes;
+}
@@ -0,0 +1,654 @@
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "mesh/meshCluster.h"
+#include "mesh/Quadric.h"
+
+#ifdef _WIN32
+#define pm_fseek _fseeki64
+#define pm_ftell _ftelli64
+#else
+#define pm_fseek fseeko
+#define pm_ftell ftello
+#endif
+
+namespace
+{
+	constexpr size_t kReadChunk = 256 << 10;
+
+	//=======================================================================LINE READER
+	// fixed-size buffered reads, a line at a time. Only the unfinished
+	// tail of a chunk is carried over, so memory is one chunk plus the
+	// longest line
+	class LineReader
+	{
+	public:
+		explicit LineReader(std::FILE *f) : file(f), buffer(kReadChunk) {}
+
+		bool next(const char *&begin, const char *&end)
+		{
+			for (;;)
+			{
+				const char *nl = static_cast<const char *>(std::memchr(buffer.data() + pos, '\n', filled - pos));
+				if (nl)
+				{
+					begin = buffer.data() + pos;
+					end = nl;
+					pos = nl - buffer.data() + 1;
+					return true;
+				}
+				if (eof)
+				{
+					if (pos == filled)
+						return false;
+					begin = buffer.data() + pos;
+					end = buffer.data() + filled;
+					pos = filled;
+					return true;
+				}
+
+				// keep the partial line, grow only if it fills the buffer
+				std::memmove(buffer.data(), buffer.data() + pos, filled - pos);
+				filled -= pos;
+				pos = 0;
+				if (filled == buffer.size())
+					buffer.resize(buffer.size() * 2);
+				size_t got = std::fread(buffer.data() + filled, 1, buffer.size() - filled, file);
+				filled += got;
+				bytes += got;
+				if (got == 0)
+					eof = true;
+			}
+		}
+
+		uint64_t bytesRead() const { return bytes; }
+
+	private:
+		std::FILE *file;
+		std::vector<char> buffer;
+		size_t pos = 0, filled = 0;
+		uint64_t bytes = 0;
+		bool eof = false;
+	};
+
+	inline const char *skipSpace(const char *p, const char *end)
+	{
+		while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+			++p;
+		return p;
+	}
+
+	inline const char *parseFloat(const char *p, const char *end, float &out)
+	{
+		p = skipSpace(p, end);
+		if (p < end && *p == '+')
+			++p;
+
+		auto res = std::from_chars(p, end, out);
+		if (res.ec != std::errc())
+		{
+			out = 0.0f;
+			return p;
+		}
+		return res.ptr;
+	}
+
+	//=======================================================================POSITION SPILL
+	// OBJ positions, written to an unnamed temporary file in blocks and read
+	// back through a direct-mapped cache. Faces mostly refer to recent
+	// positions, which are still in the unwritten tail block
+	class PositionSpill
+	{
+	public:
+		static constexpr size_t kBlock = 4096; // positions per block
+
+		explicit PositionSpill(size_t cacheBytes) : file(std::tmpfile())
+		{
+			size_t slotCount = std::max<size_t>(4, cacheBytes / (kBlock * sizeof(glm::vec3)));
+			slots.resize(slotCount);
+			tail.reserve(kBlock);
+		}
+		~PositionSpill()
+		{
+			if (file)
+				std::fclose(file);
+		}
+
+		bool isOpen() const { return file != nullptr; }
+		uint64_t size() const { return count; }
+		size_t memoryBytes() const { return (slots.size() + 1) * kBlock * sizeof(glm::vec3); }
+
+		bool push(const glm::vec3 &p)
+		{
+			tail.push_back(p);
+			++count;
+			if (tail.size() < kBlock)
+				return true;
+
+			pm_fseek(file, 0, SEEK_END);
+			bool ok = std::fwrite(tail.data(), sizeof(glm::vec3), kBlock, file) == kBlock;
+			tail.clear();
+			return ok;
+		}
+
+		bool get(uint64_t i, glm::vec3 &out)
+		{
+			if (i >= count)
+				return false;
+
+			uint64_t block = i / kBlock;
+			size_t offset = static_cast<size_t>(i % kBlock);
+			if (block == count / kBlock)
+			{
+				out = tail[offset];
+				return true;
+			}
+
+			Slot &slot = slots[block % slots.size()];
+			if (slot.block != block)
+			{
+				slot.data.resize(kBlock);
+				pm_fseek(file, static_cast<int64_t>(block * kBlock * sizeof(glm::vec3)), SEEK_SET);
+				if (std::fread(slot.data.data(), sizeof(glm::vec3), kBlock, file) != kBlock)
+					return false;
+				slot.block = block;
+			}
+			out = slot.data[offset];
+			return true;
+		}
+
+	private:
+		struct Slot
+		{
+			uint64_t block = ~uint64_t(0);
+			std::vector<glm::vec3> data;
+		};
+
+		std::FILE *file;
+		std::vector<glm::vec3> tail;
+		std::vector<Slot> slots;
+		uint64_t count = 0;
+	};
+
+	//=======================================================================TRIANGLE SOURCES
+	// each calls sink(a, b, c) once per triangle, in file order
+
+	template <typename Sink>
+	bool readBinarySTL(std::FILE *f, uint64_t triangles, Sink &&sink, uint64_t &bytes)
+	{
+		constexpr size_t kRecord = 50; // normal, 3 corners, attribute word
+		std::vector<unsigned char> buffer(kRecord * (kReadChunk / kRecord));
+		pm_fseek(f, 84, SEEK_SET);
+		bytes = 84;
+
+		uint64_t left = triangles;
+		while (left > 0)
+		{
+			size_t want = static_cast<size_t>(std::min<uint64_t>(left, buffer.size() / kRecord));
+			if (std::fread(buffer.data(), kRecord, want, f) != want)
+				return false;
+			bytes += want * kRecord;
+			left -= want;
+
+			for (size_t t = 0; t < want; ++t)
+			{
+				float v[9];
+				std::memcpy(v, buffer.data() + t * kRecord + 12, sizeof(v));
+				sink(glm::vec3(v[0], v[1], v[2]), glm::vec3(v[3], v[4], v[5]), glm::vec3(v[6], v[7], v[8]));
+			}
+		}
+		return true;
+	}
+
+	template <typename Sink>
+	bool readAsciiSTL(std::FILE *f, Sink &&sink, uint64_t &bytes)
+	{
+		LineReader lines(f);
+		const char *p, *end;
+		glm::vec3 corner[3];
+		int corners = 0;
+		while (lines.next(p, end))
+		{
+			p = skipSpace(p, end);
+			if (end - p < 7 || std::memcmp(p, "vertex", 6) != 0)
+			{
+				// facets close with endloop; anything but a triangle is dropped
+				if (end - p >= 7 && std::memcmp(p, "endloop", 7) == 0)
+					corners = 0;
+				continue;
+			}
+
+			if (corners < 3)
+			{
+				glm::vec3 &c = corner[corners++];
+				const char *q = parseFloat(p + 6, end, c.x);
+				q = parseFloat(q, end, c.y);
+				parseFloat(q, end, c.z);
+			}
+			if (corners == 3)
+			{
+				sink(corner[0], corner[1], corner[2]);
+				corners = 4; // ignore extra corners until endloop
+			}
+		}
+		bytes = lines.bytesRead();
+		return true;
+	}
+
+	// polygons are fanned; texture and normal indices are skipped
+	template <typename Sink>
+	bool readOBJ(std::FILE *f, PositionSpill &spill, Sink &&sink, uint64_t &bytes)
+	{
+		if (!spill.isOpen())
+		{
+			std::cerr << "Cluster: no temporary file for OBJ positions" << std::endl;
+			return false;
+		}
+
+		LineReader lines(f);
+		const char *p, *end;
+		std::vector<glm::vec3> face;
+		bool ok = true;
+		while (ok && lines.next(p, end))
+		{
+			p = skipSpace(p, end);
+			if (end - p < 2 || (p[1] != ' ' && p[1] != '\t'))
+				continue;
+
+			if (p[0] == 'v')
+			{
+				glm::vec3 pos;
+				const char *q = parseFloat(p + 2, end, pos.x);
+				q = parseFloat(q, end, pos.y);
+				parseFloat(q, end, pos.z);
+				ok = spill.push(pos);
+			}
+			else if (p[0] == 'f')
+			{
+				face.clear();
+				const char *q = p + 2;
+				for (;;)
+				{
+					q = skipSpace(q, end);
+					if (q < end && *q == '+')
+						++q;
+					int64_t raw = 0;
+					auto res = std::from_chars(q, end, raw);
+					if (res.ec != std::errc())
+						break;
+					q = res.ptr;
+					while (q < end && *q != ' ' && *q != '\t')
+						++q;
+
+					// 1-based, negative counts back from the latest position
+					int64_t index = raw > 0 ? raw - 1 : static_cast<int64_t>(spill.size()) + raw;
+					glm::vec3 pos;
+					if (index < 0 || !spill.get(static_cast<uint64_t>(index), pos))
+					{
+						face.clear();
+						break;
+					}
+					face.push_back(pos);
+				}
+
+				for (size_t k = 2; k < face.size(); ++k)
+					sink(face[0], face[k - 1], face[k]);
+			}
+		}
+		bytes = lines.bytesRead();
+		if (!ok)
+			std::cerr << "Cluster: failed to spill OBJ positions" << std::endl;
+		return ok;
+	}
+
+	//=======================================================================GRID
+	struct Cell
+	{
+		Quadric q;
+		glm::vec3 sum{0.0f};	// of corner positions, for the fallback mean
+		glm::vec3 normal{0.0f}; // area weighted
+		uint32_t count = 0;
+		uint32_t id = 0; // output vertex, assigned at the end
+	};
+
+	// cell coordinates, 21 bits each, biased so they pack as unsigned
+	constexpr int kCoordBits = 21;
+	constexpr int64_t kCoordLimit = int64_t(1) << (kCoordBits - 1);
+
+	uint64_t packCell(int64_t x, int64_t y, int64_t z)
+	{
+		constexpr uint64_t mask = (uint64_t(1) << kCoordBits) - 1;
+		return (uint64_t(x + kCoordLimit) & mask) |
+			   ((uint64_t(y + kCoordLimit) & mask) << kCoordBits) |
+			   ((uint64_t(z + kCoordLimit) & mask) << (2 * kCoordBits));
+	}
+
+	void unpackCell(uint64_t key, int64_t c[3])
+	{
+		constexpr uint64_t mask = (uint64_t(1) << kCoordBits) - 1;
+		for (int k = 0; k < 3; ++k)
+			c[k] = static_cast<int64_t>((key >> (k * kCoordBits)) & mask) - kCoordLimit;
+	}
+
+	// the cell twice the size containing this one
+	uint64_t parentCell(uint64_t key)
+	{
+		int64_t c[3];
+		unpackCell(key, c);
+		auto half = [](int64_t v)
+		{ return v >= 0 ? v / 2 : -((1 - v) / 2); };
+		return packCell(half(c[0]), half(c[1]), half(c[2]));
+	}
+
+	// three cells in winding order, rotated so the smallest comes first;
+	// the same triangle from two sources then gives the same key
+	struct TriKey
+	{
+		uint64_t c[3];
+
+		TriKey(uint64_t a, uint64_t b, uint64_t d)
+		{
+			if (b < a && b < d)
+				c[0] = b, c[1] = d, c[2] = a;
+			else if (d < a && d < b)
+				c[0] = d, c[1] = a, c[2] = b;
+			else
+				c[0] = a, c[1] = b, c[2] = d;
+		}
+
+		bool operator==(const TriKey &o) const { return c[0] == o.c[0] && c[1] == o.c[1] && c[2] == o.c[2]; }
+		bool operator<(const TriKey &o) const { return std::lexicographical_compare(c, c + 3, o.c, o.c + 3); }
+	};
+
+	struct TriKeyHash
+	{
+		size_t operator()(const TriKey &t) const
+		{
+			uint64_t h = t.c[0] * 0x9e3779b97f4a7c15ull;
+			h ^= t.c[1] * 0xc2b2ae3d27d4eb4full + (h >> 29);
+			h ^= t.c[2] * 0x165667b19e3779f9ull + (h >> 32);
+			return static_cast<size_t>(h ^ (h >> 31));
+		}
+	};
+
+	// heap bytes of a node-based hash container, roughly: each element in
+	// its own node with a next pointer and a cached hash, plus the buckets
+	template <typename Container>
+	size_t hashBytes(const Container &c)
+	{
+		size_t node = (sizeof(typename Container::value_type) + 2 * sizeof(void *) + 15) & ~size_t(15);
+		return c.size() * node + c.bucket_count() * sizeof(void *);
+	}
+
+	class ClusterGrid
+	{
+	public:
+		ClusterGrid(size_t budget, size_t maxTriangles, float cellSize)
+			: budget(budget), maxTriangles(maxTriangles), size(cellSize)
+		{
+		}
+
+		void add(const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c)
+		{
+			if (!std::isfinite(a.x + a.y + a.z + b.x + b.y + b.z + c.x + c.y + c.z))
+				return;
+
+			if (!started)
+			{
+				origin = a;
+				if (size <= 0.0f)
+				{
+					// a quarter of the first triangle's shortest edge; the
+					// budget coarsens it from there
+					float shortest = std::min({glm::length(b - a), glm::length(c - b), glm::length(a - c)});
+					size = shortest > 0.0f ? 0.25f * shortest : 1e-6f;
+				}
+				started = true;
+			}
+
+			// relative to the first vertex, so far-off scans keep their precision
+			glm::vec3 p[3] = {a - origin, b - origin, c - origin};
+			uint64_t key[3];
+			while (!cellsOf(p, key))
+				coarsen();
+
+			glm::vec3 n = glm::cross(p[1] - p[0], p[2] - p[0]);
+			float twiceArea = glm::length(n);
+			Quadric q;
+			if (twiceArea > 0.0f)
+			{
+				// area-weighted plane: scaling the plane by sqrt(area) scales
+				// its quadric by area
+				glm::vec3 unit = n / twiceArea;
+				q = Quadric(glm::vec4(unit, -glm::dot(unit, p[0])) * std::sqrt(0.5f * twiceArea));
+			}
+
+			for (int k = 0; k < 3; ++k)
+			{
+				Cell &cell = cells[key[k]];
+				cell.q += q;
+				cell.sum += p[k];
+				cell.normal += n;
+				cell.count++;
+			}
+
+			if (key[0] != key[1] && key[1] != key[2] && key[2] != key[0])
+				tris.insert(TriKey(key[0], key[1], key[2]));
+
+			// coarsening rebuilds both tables next to the old ones, so it
+			// starts with room to spare
+			while ((memoryBytes() > budget - budget / 4 || tris.size() > maxTriangles) && cells.size() > 1)
+				coarsen();
+			peak = std::max(peak, memoryBytes());
+		}
+
+		size_t memoryBytes() const { return hashBytes(cells) + hashBytes(tris); }
+		size_t peakBytes() const { return peak; }
+		float cellSize() const { return size; }
+		int coarsenings() const { return merges; }
+
+		// one vertex per referenced cell, triangles in a fixed order so the
+		// result doesn't depend on hash table layout
+		void extract(std::vector<Vertex> &vertices, std::vector<Triangle> &triangles)
+		{
+			std::vector<TriKey> sorted;
+			sorted.reserve(tris.size());
+			while (!tris.empty())
+				sorted.push_back(tris.extract(tris.begin()).value());
+			std::sort(sorted.begin(), sorted.end());
+
+			for (auto &entry : cells)
+				entry.second.id = ~0u;
+
+			vertices.clear();
+			triangles.clear();
+			triangles.reserve(sorted.size());
+			for (const TriKey &t : sorted)
+			{
+				VertexID id[3];
+				for (int k = 0; k < 3; ++k)
+				{
+					auto found = cells.find(t.c[k]);
+					Cell &cell = found->second;
+					if (cell.id == ~0u)
+					{
+						cell.id = static_cast<uint32_t>(vertices.size());
+						vertices.push_back(place(found->first, cell));
+					}
+					id[k] = static_cast<VertexID>(cell.id);
+				}
+				triangles.emplace_back(id[0], id[1], id[2]);
+			}
+		}
+
+	private:
+		bool cellsOf(const glm::vec3 p[3], uint64_t key[3]) const
+		{
+			for (int v = 0; v < 3; ++v)
+			{
+				int64_t c[3];
+				for (int k = 0; k < 3; ++k)
+				{
+					double x = std::floor(static_cast<double>(p[v][k]) / size);
+					if (!(std::abs(x) < static_cast<double>(kCoordLimit)))
+						return false;
+					c[k] = static_cast<int64_t>(x);
+				}
+				key[v] = packCell(c[0], c[1], c[2]);
+			}
+			return true;
+		}
+
+		// double the cell size: merge each 2x2x2 block of cells into one and
+		// drop the triangles that now have two corners in the same cell
+		void coarsen()
+		{
+			size *= 2.0f;
+			merges++;
+
+			std::unordered_map<uint64_t, Cell> merged;
+			merged.reserve(cells.size() / 4 + 1);
+			while (!cells.empty())
+			{
+				auto node = cells.extract(cells.begin());
+				Cell &into = merged[parentCell(node.key())];
+				into.q += node.mapped().q;
+				into.sum += node.mapped().sum;
+				into.normal += node.mapped().normal;
+				into.count += node.mapped().count;
+			}
+			cells.swap(merged);
+
+			std::unordered_set<TriKey, TriKeyHash> kept;
+			kept.reserve(tris.size() / 4 + 1);
+			while (!tris.empty())
+			{
+				TriKey t = tris.extract(tris.begin()).value();
+				uint64_t a = parentCell(t.c[0]), b = parentCell(t.c[1]), c = parentCell(t.c[2]);
+				if (a != b && b != c && c != a)
+					kept.insert(TriKey(a, b, c));
+			}
+			tris.swap(kept);
+		}
+
+		Vertex place(uint64_t key, const Cell &cell) const
+		{
+			int64_t c[3];
+			unpackCell(key, c);
+			glm::vec3 lo(float(c[0]) * size, float(c[1]) * size, float(c[2]) * size);
+			glm::vec3 hi = lo + glm::vec3(size);
+
+			glm::vec3 pos;
+			bool inside = cell.q.minimizer(pos);
+			for (int k = 0; k < 3 && inside; ++k)
+				inside = pos[k] >= lo[k] && pos[k] <= hi[k];
+			if (!inside)
+				pos = cell.sum / float(cell.count);
+
+			Vertex v;
+			v.Position = origin + pos;
+			float len = glm::length(cell.normal);
+			v.Normal = len > 0.0f ? cell.normal / len : glm::vec3(0.0f, 0.0f, 1.0f);
+			return v;
+		}
+
+		size_t budget;
+		size_t maxTriangles;
+		float size;
+		bool started = false;
+		glm::vec3 origin{0.0f};
+		int merges = 0;
+		size_t peak = 0;
+
+		std::unordered_map<uint64_t, Cell> cells;
+		std::unordered_set<TriKey, TriKeyHash> tris;
+	};
+}
+
+bool clusterSimplify(const std::string &path, const ClusterOptions &options,
+					 std::vector<Vertex> &vertices, std::vector<Triangle> &triangles,
+					 ClusterStats *stats)
+{
+	vertices.clear();
+	triangles.clear();
+
+	std::FILE *f = std::fopen(path.c_str(), "rb");
+	if (!f)
+	{
+		std::cerr << "Cluster: could not open " << path << std::endl;
+		return false;
+	}
+
+	pm_fseek(f, 0, SEEK_END);
+	uint64_t fileSize = static_cast<uint64_t>(pm_ftell(f));
+	pm_fseek(f, 0, SEEK_SET);
+
+	std::string ext = path.size() >= 4 ? path.substr(path.size() - 4) : "";
+	std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char ch)
+				   { return static_cast<char>(std::tolower(ch)); });
+
+	// the read buffer and, for OBJ, the position cache (an eighth of the
+	// budget) come off the top; the grid gets the rest
+	std::unique_ptr<PositionSpill> spill;
+	if (ext == ".obj")
+		spill = std::make_unique<PositionSpill>(options.memoryBudget / 8);
+	size_t fixedBytes = kReadChunk + (spill ? spill->memoryBytes() : 0);
+	size_t gridBytes = options.memoryBudget > 2 * fixedBytes ? options.memoryBudget - fixedBytes : options.memoryBudget / 2;
+
+	ClusterGrid grid(gridBytes, std::max<size_t>(options.maxTriangles, 1), options.cellSize);
+	uint64_t count = 0;
+	auto sink = [&](const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c)
+	{
+		grid.add(a, b, c);
+		count++;
+	};
+
+	bool ok;
+	uint64_t bytes = 0;
+	if (spill)
+		ok = readOBJ(f, *spill, sink, bytes);
+	else
+	{
+		// binary STL when the size matches its triangle count, else ASCII
+		uint32_t binaryCount = 0;
+		unsigned char header[84];
+		bool binary = fileSize >= 84 && std::fread(header, 1, 84, f) == 84 &&
+					  (std::memcpy(&binaryCount, header + 80, 4), 84 + uint64_t(binaryCount) * 50 == fileSize);
+		if (binary)
+			ok = readBinarySTL(f, binaryCount, sink, bytes);
+		else
+		{
+			pm_fseek(f, 0, SEEK_SET);
+			ok = readAsciiSTL(f, sink, bytes);
+		}
+	}
+	std::fclose(f);
+	spill.reset();
+
+	if (!ok || count == 0)
+	{
+		if (ok)
+			std::cerr << "Cluster: no triangles in " << path << std::endl;
+		return false;
+	}
+
+	if (stats)
+	{
+		stats->inputTriangles = count;
+		stats->inputBytes = bytes;
+		stats->cellSize = grid.cellSize();
+		stats->coarsenings = grid.coarsenings();
+		stats->peakBytes = grid.peakBytes() + fixedBytes;
+	}
+
+	grid.extract(vertices, triangles);
+	return !triangles.empty();
+}
@@ -0,0 +1,249 @@
+#include <algorithm>
+#include <cmath>
+
+#include "mesh/meshGen.h"
+
+namespace
+{
+	const float kPi = 3.14159265358979f;
+
+	uint32_t hash(uint32_t x, uint32_t y, uint32_t seed)
+	{
+		uint32_t h = x * 0x8da6b343u ^ y * 0xd8163841u ^ seed * 0xcb1ab31fu;
+		h ^= h >> 13;
+		h *= 0x5bd1e995u;
+		return h ^ (h >> 15);
+	}
+
+	// smooth value noise in [-1, 1], a few octaves
+	float fractalNoise(float x, float y, uint32_t seed)
+	{
+		float sum = 0.0f, amplitude = 1.0f;
+		for (int octave = 0; octave < 5; ++octave)
+		{
+			float fx = std::floor(x), fy = std::floor(y);
+			uint32_t ix = static_cast<uint32_t>(static_cast<int32_t>(fx));
+			uint32_t iy = static_cast<uint32_t>(static_cast<int32_t>(fy));
+			float tx = x - fx, ty = y - fy;
+			tx = tx * tx * (3.0f - 2.0f * tx);
+			ty = ty * ty * (3.0f - 2.0f * ty);
+
+			auto corner = [&](uint32_t cx, uint32_t cy)
+			{ return hash(cx, cy, seed + octave) * (2.0f / 4294967295.0f) - 1.0f; };
+			float a = corner(ix, iy) + (corner(ix + 1, iy) - corner(ix, iy)) * tx;
+			float b = corner(ix, iy + 1) + (corner(ix + 1, iy + 1) - corner(ix, iy + 1)) * tx;
+			sum += amplitude * (a + (b - a) * ty);
+
+			x *= 2.0f;
+			y *= 2.0f;
+			amplitude *= 0.5f;
+		}
+		return sum / 1.9375f;
+	}
+
+	void sphere(uint64_t target, std::vector<Vertex> &verts, std::vector<Triangle> &tris)
+	{
+		const float t = (1.0f + std::sqrt(5.0f)) * 0.5f;
+		const glm::vec3 corners[12] = {{-1, t, 0}, {1, t, 0}, {-1, -t, 0}, {1, -t, 0},
+									   {0, -1, t}, {0, 1, t}, {0, -1, -t}, {0, 1, -t},
+									   {t, 0, -1}, {t, 0, 1}, {-t, 0, -1}, {-t, 0, 1}};
+		const int faces[20][3] = {{0, 11, 5}, {0, 5, 1}, {0, 1, 7}, {0, 7, 10}, {0, 10, 11},
+								  {1, 5, 9}, {5, 11, 4}, {11, 10, 2}, {10, 7, 6}, {7, 1, 8},
+								  {3, 9, 4}, {3, 4, 2}, {3, 2, 6}, {3, 6, 8}, {3, 8, 9},
+								  {4, 9, 5}, {2, 4, 11}, {6, 2, 10}, {8, 6, 7}, {9, 8, 1}};
+
+		// the 30 edges, numbered in the order faces first use them
+		int edgeIndex[12][12];
+		std::fill(&edgeIndex[0][0], &edgeIndex[0][0] + 144, -1);
+		int edges = 0;
+		for (const auto &f : faces)
+			for (int k = 0; k < 3; ++k)
+			{
+				int a = std::min(f[k], f[(k + 1) % 3]), b = std::max(f[k], f[(k + 1) % 3]);
+				if (edgeIndex[a][b] < 0)
+					edgeIndex[a][b] = edgeIndex[b][a] = edges++;
+			}
+
+		// corners, then n - 1 vertices per edge, then each face's inside
+		const int64_t n = std::max<int64_t>(1, std::llround(std::sqrt(target / 20.0)));
+		const int64_t edgeBase = 12, faceBase = edgeBase + 30 * (n - 1);
+		const int64_t insidePerFace = (n - 1) * (n - 2) / 2;
+		verts.assign(static_cast<size_t>(faceBase + 20 * insidePerFace), Vertex());
+		tris.clear();
+		tris.reserve(static_cast<size_t>(20 * n * n));
+
+		// `step` of n along p -> q, the same id from either side
+		auto edgeVertex = [&](int p, int q, int64_t step)
+		{
+			int64_t e = edgeIndex[p][q];
+			return edgeBase + e * (n - 1) + (p < q ? step - 1 : n - 1 - step);
+		};
+
+		std::vector<VertexID> row(static_cast<size_t>((n + 1) * (n + 2) / 2));
+		for (int f = 0; f < 20; ++f)
+		{
+			const int A = faces[f][0], B = faces[f][1], C = faces[f][2];
+			const glm::vec3 a = corners[A], b = corners[B], c = corners[C];
+
+			// ids of the face's (i, j) grid, i towards B and j towards C
+			auto at = [&](int64_t i, int64_t j) -> VertexID &
+			{ return row[static_cast<size_t>(j * (n + 1) - j * (j - 1) / 2 + i)]; };
+
+			int64_t inside = faceBase + f * insidePerFace;
+			for (int64_t j = 0; j <= n; ++j)
+				for (int64_t i = 0; i + j <= n; ++i)
+				{
+					int64_t id;
+					if (i == 0 && j == 0)
+						id = A;
+					else if (i == n)
+						id = B;
+					else if (j == n)
+						id = C;
+					else if (j == 0)
+						id = edgeVertex(A, B, i);
+					else if (i == 0)
+						id = edgeVertex(A, C, j);
+					else if (i + j == n)
+						id = edgeVertex(B, C, j);
+					else
+						id = inside++;
+
+					at(i, j) = static_cast<VertexID>(id);
+					glm::vec3 p = glm::normalize(a + (b - a) * (float(i) / n) + (c - a) * (float(j) / n));
+					Vertex &v = verts[static_cast<size_t>(id)];
+					v.Position = p;
+					v.Normal = p;
+					v.TexCoords = glm::vec2(0.5f + std::atan2(p.z, p.x) / (2.0f * kPi), 0.5f - std::asin(p.y) / kPi);
+				}
+
+			for (int64_t j = 0; j < n; ++j)
+				for (int64_t i = 0; i + j < n; ++i)
+				{
+					tris.emplace_back(at(i, j), at(i + 1, j), at(i, j + 1));
+					if (i + j + 1 < n)
+						tris.emplace_back(at(i + 1, j), at(i + 1, j + 1), at(i, j + 1));
+				}
+		}
+	}
+
+	void terrain(uint64_t target, uint32_t seed, std::vector<Vertex> &verts, std::vector<Triangle> &tris)
+	{
+		const int64_t n = std::max<int64_t>(1, std::llround(std::sqrt(target / 2.0)));
+		const float amplitude = 0.15f;
+		const float scale = 6.0f; // noise cells across the grid
+
+		auto height = [&](float x, float y)
+		{ return amplitude * fractalNoise(x * scale, y * scale, seed); };
+
+		verts.assign(static_cast<size_t>((n + 1) * (n + 1)), Vertex());
+		const float d = 1.0f / n;
+		for (int64_t y = 0; y <= n; ++y)
+			for (int64_t x = 0; x <= n; ++x)
+			{
+				float fx = x * d, fy = y * d;
+				Vertex &v = verts[static_cast<size_t>(y * (n + 1) + x)];
+				v.Position = glm::vec3(fx, height(fx, fy), fy);
+				float dx = height(fx + d, fy) - height(fx - d, fy);
+				float dy = height(fx, fy + d) - height(fx, fy - d);
+				v.Normal = glm::normalize(glm::vec3(-dx, 2.0f * d, -dy));
+				v.TexCoords = glm::vec2(fx, fy);
+			}
+
+		tris.clear();
+		tris.reserve(static_cast<size_t>(2 * n * n));
+		for (int64_t y = 0; y < n; ++y)
+			for (int64_t x = 0; x < n; ++x)
+			{
+				VertexID a = static_cast<VertexID>(y * (n + 1) + x), b = a + 1;
+				VertexID c = static_cast<VertexID>(a + n + 1), e = c + 1;
+				tris.emplace_back(a, c, b);
+				tris.emplace_back(b, c, e);
+			}
+	}
+
+	// S spokes and R rings give S * (2R - 1) triangles, the centre has
+	// valence S
+	void spokes(uint64_t target, uint32_t seed, int64_t S, std::vector<Vertex> &verts, std::vector<Triangle> &tris)
+	{
+		S = std::max<int64_t>(16, std::min<int64_t>(S, static_cast<int64_t>(target / 2)));
+		const int64_t R = std::max<int64_t>(1, std::llround((target / double(S) + 1.0) / 2.0));
+
+		verts.assign(static_cast<size_t>(1 + R * S), Vertex());
+		verts[0].Position = glm::vec3(0.0f, 0.2f, 0.0f);
+		verts[0].Normal = glm::vec3(0.0f, 1.0f, 0.0f);
+		verts[0].TexCoords = glm::vec2(0.5f);
+		for (int64_t r = 1; r <= R; ++r)
+			for (int64_t k = 0; k < S; ++k)
+			{
+				float rho = float(r) / R, theta = 2.0f * kPi * k / S;
+				float x = rho * std::cos(theta), z = rho * std::sin(theta);
+				// a low dome with some bumps, so collapses have a price
+				float y = 0.2f * (1.0f - rho * rho) + 0.02f * fractalNoise(4.0f * x, 4.0f * z, seed);
+				Vertex &v = verts[static_cast<size_t>(1 + (r - 1) * S + k)];
+				v.Position = glm::vec3(x, y, z);
+				v.Normal = glm::normalize(glm::vec3(0.8f * x, 1.0f, 0.8f * z));
+				v.TexCoords = glm::vec2(0.5f + 0.5f * x, 0.5f + 0.5f * z);
+			}
+
+		auto ring = [&](int64_t r, int64_t k)
+		{ return static_cast<VertexID>(1 + (r - 1) * S + k % S); };
+
+		tris.clear();
+		tris.reserve(static_cast<size_t>(S * (2 * R - 1)));
+		for (int64_t k = 0; k < S; ++k)
+			tris.emplace_back(0, ring(1, k + 1), ring(1, k));
+		for (int64_t r = 1; r < R; ++r)
+			for (int64_t k = 0; k < S; ++k)
+			{
+				tris.emplace_back(ring(r, k), ring(r, k + 1), ring(r + 1, k));
+				tris.emplace_back(ring(r, k + 1), ring(r + 1, k + 1), ring(r + 1, k));
+			}
+	}
+}
+
+const char *genShapeName(GenShape shape)
+{
+	switch (shape)
+	{
+	case GenShape::Sphere:
+		return "sphere";
+	case GenShape::Terrain:
+		return "terrain";
+	case GenShape::Spokes:
+		return "spokes";
+	case GenShape::Fan:
+		return "fan";
+	}
+	return "unknown";
+}
+
+void generateMesh(GenShape shape, uint64_t targetTriangles, uint32_t seed,
+				  std::vector<Vertex> &vertices, std::vector<Triangle> &triangles)
+{
+	switch (shape)
+	{
+	case GenShape::Sphere:
+		sphere(targetTriangles, vertices, triangles);
+		break;
+	case GenShape::Terrain:
+		terrain(targetTriangles, seed, vertices, triangles);
+		break;
+	case GenShape::Spokes:
+		// the same valence at every size, so time per triangle should stay flat
+		spokes(targetTriangles, seed, 512, vertices, triangles);
+		break;
+	case GenShape::Fan:
+		// about as many spokes as rings
+		spokes(targetTriangles, seed, std::llround(std::sqrt(double(targetTriangles))), vertices, triangles);
+		break;
+	}
+}
+
+Mesh generateMesh(GenShape shape, uint64_t targetTriangles, uint32_t seed)
+{
+	std::vector<Vertex> vertices;
+	std::vector<Triangle> triangles;
+	generateMesh(shape, targetTriangles, seed, vertices, triangles);
+	return Mesh(vertices, std::move(triangles));
+}
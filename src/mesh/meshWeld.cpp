@@ -0,0 +1,116 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+#include "core/JobSystem.h"
+#include "mesh/meshWeld.h"
+
+namespace
+{
+	using Cell = std::array<int64_t, 3>;
+
+	uint64_t hashCell(const Cell &c)
+	{
+		uint64_t h = static_cast<uint64_t>(c[0]) * 0x9e3779b97f4a7c15ull;
+		h ^= static_cast<uint64_t>(c[1]) * 0xc2b2ae3d27d4eb4full + (h >> 29);
+		h ^= static_cast<uint64_t>(c[2]) * 0x165667b19e3779f9ull + (h >> 32);
+		return h ^ (h >> 31);
+	}
+
+	// the grid cell, or for exact welding the bit pattern, -0 read as 0
+	Cell cellOf(const glm::vec3 &p, float epsilon)
+	{
+		Cell c;
+		for (int k = 0; k < 3; ++k)
+		{
+			if (epsilon > 0.0f)
+			{
+				double x = std::floor(static_cast<double>(p[k]) / epsilon);
+				c[k] = static_cast<int64_t>(std::clamp(x, -4.0e18, 4.0e18));
+			}
+			else
+			{
+				float x = p[k] == 0.0f ? 0.0f : p[k];
+				uint32_t bits;
+				std::memcpy(&bits, &x, sizeof(bits));
+				c[k] = bits;
+			}
+		}
+		return c;
+	}
+}
+
+std::vector<uint32_t> weldPositions(const std::vector<glm::vec3> &positions, float epsilon)
+{
+	const size_t n = positions.size();
+	std::vector<uint32_t> remap(n);
+	if (n == 0)
+		return remap;
+
+	JobSystem &jobs = JobSystem::global();
+	size_t buckets = 1;
+	while (buckets < 2 * n)
+		buckets <<= 1;
+
+	std::vector<Cell> cells(n);
+	std::vector<uint32_t> bucketOf(n);
+	jobs.parallelFor(0, n, 4096, [&](size_t first, size_t last)
+					 {
+		for (size_t i = first; i < last; ++i)
+		{
+			cells[i] = cellOf(positions[i], epsilon);
+			bucketOf[i] = static_cast<uint32_t>(hashCell(cells[i]) & (buckets - 1));
+		} });
+
+	// counting sort by bucket; within a bucket positions stay in index
+	// order, so the first match found is the lowest
+	std::vector<uint32_t> start(buckets + 1, 0);
+	for (uint32_t b : bucketOf)
+		start[b + 1]++;
+	for (size_t b = 0; b < buckets; ++b)
+		start[b + 1] += start[b];
+	std::vector<uint32_t> order(n);
+	{
+		std::vector<uint32_t> fill(start.begin(), start.end() - 1);
+		for (size_t i = 0; i < n; ++i)
+			order[fill[bucketOf[i]]++] = static_cast<uint32_t>(i);
+	}
+
+	const float epsilon2 = epsilon * epsilon;
+	const int reach = epsilon > 0.0f ? 1 : 0;
+	jobs.parallelFor(0, n, 1024, [&](size_t first, size_t last)
+					 {
+		for (size_t i = first; i < last; ++i)
+		{
+			uint32_t best = static_cast<uint32_t>(i);
+			const Cell &home = cells[i];
+			for (int dx = -reach; dx <= reach; ++dx)
+				for (int dy = -reach; dy <= reach; ++dy)
+					for (int dz = -reach; dz <= reach; ++dz)
+					{
+						Cell c{home[0] + dx, home[1] + dy, home[2] + dz};
+						uint64_t b = hashCell(c) & (buckets - 1);
+						for (uint32_t k = start[b]; k < start[b + 1] && order[k] < best; ++k)
+						{
+							uint32_t j = order[k];
+							if (cells[j] != c)
+								continue;
+
+							glm::vec3 d = positions[j] - positions[i];
+							if (epsilon > 0.0f ? glm::dot(d, d) <= epsilon2 : d == glm::vec3(0.0f))
+							{
+								best = j;
+								break;
+							}
+						}
+					}
+			remap[i] = best;
+		} });
+
+	// representatives come first, so one forward pass closes the chains
+	for (size_t i = 0; i < n; ++i)
+		remap[i] = remap[remap[i]];
+
+	return remap;
+}
@@ -1,14 +1,432 @@
+#include <charconv>
+#include <cstring>
+#include <algorithm>
+#include <unordered_map>
+
 #include "mesh/objLoader.h"
+#include "mesh/meshWeld.h"
+#include "core/JobSystem.h"
+#include "io/MappedFile.h"
 
 /*
 	for loading the obj files
 	getting their edges, faces & verts
 */
 
+#pragma region FastLoader
+namespace
+{
+	// files below this size are parsed on the calling thread only
+	constexpr size_t kMinChunkBytes = 1 << 20;
+
+	// everything one newline-aligned slice of the file contributes.
+	// face corners are stored as (v, t, n) triplets of 0-based indices,
+	// -1 where an attribute is missing
+	struct ObjChunk
+	{
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec2> UVs;
+		std::vector<glm::vec3> normals;
+
+		std::vector<int> corners;
+		std::vector<int> faceSizes;
+
+		// corner slots holding negative (relative) OBJ indices, resolved
+		// against this chunk only; the merge adds the preceding chunks' counts
+		std::vector<size_t> relativeSlots;
+	};
+
+	inline bool isSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	inline const char *skipSpace(const char *p, const char *end)
+	{
+		while (p < end && isSpace(*p))
+			++p;
+		return p;
+	}
+
+	inline const char *parseFloat(const char *p, const char *end, float &out)
+	{
+		p = skipSpace(p, end);
+		if (p < end && *p == '+')
+			++p;
+
+		auto res = std::from_chars(p, end, out);
+		if (res.ec != std::errc())
+		{
+			out = 0.0f;
+			return p;
+		}
+		return res.ptr;
+	}
+
+	inline const char *parseInt(const char *p, const char *end, int &out, bool &ok)
+	{
+		if (p < end && *p == '+')
+			++p;
+
+		auto res = std::from_chars(p, end, out);
+		ok = res.ec == std::errc();
+		return ok ? res.ptr : p;
+	}
+
+	// OBJ indices are 1-based, negative ones count back from the current end
+	inline int resolveIndex(ObjChunk &chunk, int raw, size_t localCount, int attr)
+	{
+		if (raw > 0)
+			return raw - 1;
+		if (raw == 0)
+			return -1;
+
+		chunk.relativeSlots.push_back(chunk.corners.size() + attr);
+		return static_cast<int>(localCount) + raw;
+	}
+
+	void parseFace(const char *p, const char *end, ObjChunk &chunk)
+	{
+		int count = 0;
+
+		while (true)
+		{
+			p = skipSpace(p, end);
+			if (p >= end)
+				break;
+
+			int raw = 0;
+			bool ok = false;
+			p = parseInt(p, end, raw, ok);
+			if (!ok)
+			{
+				// not a number, skip the token
+				while (p < end && !isSpace(*p))
+					++p;
+				continue;
+			}
+
+			int vi = resolveIndex(chunk, raw, chunk.positions.size(), 0);
+			int ti = -1, ni = -1;
+
+			if (p < end && *p == '/')
+			{
+				++p;
+				// f v1/vt1 or f v1/vt1/vn1, missing for f v1//vn1
+				if (p < end && *p != '/')
+				{
+					p = parseInt(p, end, raw, ok);
+					if (ok)
+						ti = resolveIndex(chunk, raw, chunk.UVs.size(), 1);
+				}
+				if (p < end && *p == '/')
+				{
+					++p;
+					p = parseInt(p, end, raw, ok);
+					if (ok)
+						ni = resolveIndex(chunk, raw, chunk.normals.size(), 2);
+				}
+			}
+
+			chunk.corners.push_back(vi);
+			chunk.corners.push_back(ti);
+			chunk.corners.push_back(ni);
+			++count;
+
+			// ignore anything else left in the token
+			while (p < end && !isSpace(*p))
+				++p;
+		}
+
+		chunk.faceSizes.push_back(count);
+	}
+
+	void parseChunk(const char *p, const char *end, ObjChunk &chunk)
+	{
+		while (p < end)
+		{
+			const char *lineEnd = static_cast<const char *>(std::memchr(p, '\n', end - p));
+			if (!lineEnd)
+				lineEnd = end;
+
+			size_t len = lineEnd - p;
+			if (len >= 2 && p[0] == 'v' && isSpace(p[1]))
+			{
+				glm::vec3 pos;
+				const char *q = parseFloat(p + 2, lineEnd, pos.x);
+				q = parseFloat(q, lineEnd, pos.y);
+				parseFloat(q, lineEnd, pos.z);
+				chunk.positions.push_back(pos);
+			}
+			else if (len >= 3 && p[0] == 'v' && p[1] == 't' && isSpace(p[2]))
+			{
+				glm::vec2 uv;
+				const char *q = parseFloat(p + 3, lineEnd, uv.x);
+				parseFloat(q, lineEnd, uv.y);
+				chunk.UVs.push_back(uv);
+			}
+			else if (len >= 3 && p[0] == 'v' && p[1] == 'n' && isSpace(p[2]))
+			{
+				glm::vec3 norm;
+				const char *q = parseFloat(p + 3, lineEnd, norm.x);
+				q = parseFloat(q, lineEnd, norm.y);
+				parseFloat(q, lineEnd, norm.z);
+				chunk.normals.push_back(norm);
+			}
+			else if (len >= 2 && p[0] == 'f' && isSpace(p[1]))
+			{
+				parseFace(p + 2, lineEnd, chunk);
+			}
+
+			p = lineEnd + 1;
+		}
+	}
+
+	// what makes two face corners the same vertex: the welded position and,
+	// when seams are split, the attribute values
+	struct WedgeKey
+	{
+		uint32_t words[6];
+		bool operator==(const WedgeKey &o) const { return std::memcmp(words, o.words, sizeof(words)) == 0; }
+	};
+
+	struct WedgeKeyHash
+	{
+		size_t operator()(const WedgeKey &k) const
+		{
+			uint64_t h = 0xcbf29ce484222325ull;
+			for (uint32_t w : k.words)
+				h = (h ^ w) * 0x100000001b3ull;
+			return static_cast<size_t>(h ^ (h >> 32));
+		}
+	};
+
+	inline uint32_t floatBits(float x)
+	{
+		x = x == 0.0f ? 0.0f : x; // -0 and 0 are one value
+		uint32_t bits;
+		std::memcpy(&bits, &x, sizeof(bits));
+		return bits;
+	}
+
+	// run fn(i) for i in [0, count) on the job system, one job per index
+	template <typename Fn>
+	void runChunks(size_t count, Fn fn)
+	{
+		JobSystem::global().parallelFor(0, count, 1, [&](size_t first, size_t last)
+										{
+											for (size_t i = first; i < last; ++i)
+												fn(i); });
+	}
+}
+
+bool loadOBJ(const std::string &path,
+			 std::vector<Vertex> &vertices,
+			 std::vector<Triangle> &triangles,
+			 std::vector<unsigned int> &indices)
+{
+	return loadOBJ(path, vertices, triangles, indices, ObjLoadOptions());
+}
+
 bool loadOBJ(const std::string &path,
 			 std::vector<Vertex> &vertices,
 			 std::vector<Triangle> &triangles,
-			 std::vector<GLuint> &indices)
+			 std::vector<unsigned int> &indices,
+			 const ObjLoadOptions &options)
+{
+	MappedFile file(path);
+	if (!file.isOpen())
+	{
+		std::cerr << "Failed to open OBJ file: " << path << "\n";
+		return false;
+	}
+
+	const char *data = file.data();
+	const size_t size = file.size();
+
+	// split into newline-aligned chunks, one per core
+	size_t hw = JobSystem::global().size();
+	size_t numChunks = std::clamp<size_t>(size / kMinChunkBytes, 1, hw);
+
+	std::vector<size_t> bounds(numChunks + 1, size);
+	bounds[0] = 0;
+	for (size_t i = 1; i < numChunks; ++i)
+	{
+		size_t pos = std::max(size * i / numChunks, bounds[i - 1]);
+		const void *nl = pos < size ? std::memchr(data + pos, '\n', size - pos) : nullptr;
+		bounds[i] = nl ? static_cast<const char *>(nl) - data + 1 : size;
+	}
+
+	std::vector<ObjChunk> chunks(numChunks);
+	runChunks(numChunks, [&](size_t i)
+			  { parseChunk(data + bounds[i], data + bounds[i + 1], chunks[i]); });
+
+	// offsets of each chunk into the global position / uv / normal arrays
+	std::vector<size_t> vOffset(numChunks + 1, 0), tOffset(numChunks + 1, 0), nOffset(numChunks + 1, 0);
+	for (size_t i = 0; i < numChunks; ++i)
+	{
+		vOffset[i + 1] = vOffset[i] + chunks[i].positions.size();
+		tOffset[i + 1] = tOffset[i] + chunks[i].UVs.size();
+		nOffset[i + 1] = nOffset[i] + chunks[i].normals.size();
+	}
+
+	const size_t baseVertex = vertices.size();
+	vertices.resize(baseVertex + vOffset[numChunks]);
+	std::vector<glm::vec2> UVs(tOffset[numChunks]);
+	std::vector<glm::vec3> normals(nOffset[numChunks]);
+
+	runChunks(numChunks, [&](size_t i)
+			  {
+				  ObjChunk &c = chunks[i];
+				  for (size_t k = 0; k < c.positions.size(); ++k)
+					  vertices[baseVertex + vOffset[i] + k].Position = c.positions[k];
+				  std::copy(c.UVs.begin(), c.UVs.end(), UVs.begin() + tOffset[i]);
+				  std::copy(c.normals.begin(), c.normals.end(), normals.begin() + nOffset[i]);
+
+				  const size_t offsets[3] = {vOffset[i], tOffset[i], nOffset[i]};
+				  for (size_t slot : c.relativeSlots)
+					  c.corners[slot] += static_cast<int>(offsets[slot % 3]);
+
+				  c.positions = {};
+				  c.UVs = {};
+				  c.normals = {}; });
+
+	const int numVerts = static_cast<int>(vertices.size());
+	size_t numTris = 0;
+	for (const ObjChunk &c : chunks)
+		for (int n : c.faceSizes)
+			numTris += n >= 3 ? n - 2 : 0;
+
+	triangles.reserve(triangles.size() + numTris);
+	indices.reserve(indices.size() + numTris * 3);
+
+	// with welding or split seams, vertices are built from the face corners
+	// that use them, in order of first use; unreferenced `v` lines drop out
+	const bool wedges = options.weldEpsilon >= 0.0f || options.splitSeams;
+	std::vector<uint32_t> weldedTo;
+	std::vector<Vertex> wedgeVerts;
+	std::unordered_map<WedgeKey, int, WedgeKeyHash> wedgeIndex;
+	if (wedges)
+	{
+		std::vector<glm::vec3> positions(vertices.size() - baseVertex);
+		for (size_t i = 0; i < positions.size(); ++i)
+			positions[i] = vertices[baseVertex + i].Position;
+
+		if (options.weldEpsilon >= 0.0f)
+			weldedTo = weldPositions(positions, options.weldEpsilon);
+		else
+			for (uint32_t i = 0; i < positions.size(); ++i)
+				weldedTo.push_back(i);
+		wedgeIndex.reserve(positions.size());
+	}
+
+	// the vertex a face corner refers to. Without wedges that is its `v`
+	// line, whose attributes the corner overwrites
+	auto cornerVertex = [&](const int *corner) -> int
+	{
+		const int v = corner[0], t = corner[1], n = corner[2];
+		const bool hasNormal = n >= 0 && static_cast<size_t>(n) < normals.size();
+		const bool hasUV = t >= 0 && static_cast<size_t>(t) < UVs.size();
+		if (!wedges)
+		{
+			if (hasNormal)
+				vertices[v].Normal = normals[n];
+			if (hasUV)
+				vertices[v].TexCoords = UVs[t];
+			return v;
+		}
+
+		Vertex attributes;
+		attributes.Position = vertices[baseVertex + weldedTo[v]].Position;
+		if (hasNormal)
+			attributes.Normal = normals[n];
+		if (hasUV)
+			attributes.TexCoords = UVs[t];
+
+		WedgeKey key{{weldedTo[v], 0, 0, 0, 0, 0}};
+		if (options.splitSeams)
+		{
+			key.words[1] = floatBits(attributes.Normal.x);
+			key.words[2] = floatBits(attributes.Normal.y);
+			key.words[3] = floatBits(attributes.Normal.z);
+			key.words[4] = floatBits(attributes.TexCoords.x);
+			key.words[5] = floatBits(attributes.TexCoords.y);
+		}
+
+		auto [it, added] = wedgeIndex.try_emplace(key, static_cast<int>(wedgeVerts.size()));
+		if (added)
+			wedgeVerts.push_back(attributes);
+		else if (!options.splitSeams)
+		{
+			// one vertex per position, the last corner's attributes win
+			if (hasNormal)
+				wedgeVerts[it->second].Normal = attributes.Normal;
+			if (hasUV)
+				wedgeVerts[it->second].TexCoords = attributes.TexCoords;
+		}
+		return static_cast<int>(baseVertex) + it->second;
+	};
+
+	// faces are applied in file order so the result matches loadOBJStream
+	size_t skipped = 0;
+	for (const ObjChunk &c : chunks)
+	{
+		const int *corner = c.corners.data();
+		for (int n : c.faceSizes)
+		{
+			const int *face = corner;
+			corner += n * 3;
+
+			if (n < 3)
+				continue; // skip degenerate faces
+
+			bool valid = true;
+			for (int k = 0; k < n; ++k)
+				valid &= face[k * 3] >= 0 && face[k * 3] < numVerts;
+			if (!valid)
+			{
+				skipped++;
+				continue;
+			}
+
+			// triangulate polygons (assumes convex)
+			for (int i = 1; i + 1 < n; ++i)
+			{
+				int a = cornerVertex(face), b = cornerVertex(face + i * 3), c = cornerVertex(face + (i + 1) * 3);
+				triangles.emplace_back(a, b, c);
+
+				indices.push_back(a);
+				indices.push_back(b);
+				indices.push_back(c);
+			}
+		}
+	}
+
+	if (wedges)
+	{
+		size_t kept = 0;
+		for (size_t i = 0; i < weldedTo.size(); ++i)
+			kept += weldedTo[i] == i;
+		std::cout << "OBJ " << path << ": " << weldedTo.size() << " positions welded into " << kept
+				  << ", " << wedgeVerts.size() << " vertices\n";
+
+		vertices.resize(baseVertex);
+		vertices.insert(vertices.end(), wedgeVerts.begin(), wedgeVerts.end());
+	}
+
+	if (skipped > 0)
+		std::cerr << "OBJ " << path << ": skipped " << skipped << " faces with out-of-range vertex indices\n";
+
+	std::cout << "OBJ load complete: " << vertices.size() << " vertices, " << triangles.size() << " triangles\n";
+	return true;
+}
+#pragma endregion
+
+// original line-by-line loader, kept as the reference for loadOBJ
+bool loadOBJStream(const std::string &path,
+				   std::vector<Vertex> &vertices,
+				   std::vector<Triangle> &triangles,
+				   std::vector<unsigned int> &indices)
 {
 	std::ifstream file(path);
 	if (!file)
@@ -88,7 +506,6 @@ bool loadOBJ(const std::string &path,
 			for (size_t i = 1; i + 1 < vIdx.size(); ++i)
 			{
 				int a = vIdx[0], b = vIdx[i], c = vIdx[i + 1];
-				TriangleID tid = triangles.size();
 				triangles.emplace_back(a, b, c);
 
 				// assign normals/UVs if present
@@ -106,19 +523,6 @@ bool loadOBJ(const std::string &path,
 				if (tIdx[i + 1] >= 0 && tIdx[i + 1] < UVs.size())
 					vertices[c].TexCoords = UVs[tIdx[i + 1]];
 
-				// triangle membership
-				vertices[a].triangles.push_back(tid);
-				vertices[b].triangles.push_back(tid);
-				vertices[c].triangles.push_back(tid);
-
-				// adjacency
-				vertices[a].neighbors.push_back(b);
-				vertices[a].neighbors.push_back(c);
-				vertices[b].neighbors.push_back(a);
-				vertices[b].neighbors.push_back(c);
-				vertices[c].neighbors.push_back(a);
-				vertices[c].neighbors.push_back(b);
-
 				indices.push_back(a);
 				indices.push_back(b);
 				indices.push_back(c);
@@ -131,33 +535,58 @@ bool loadOBJ(const std::string &path,
 }
 
 // save the OBJ
-// bool saveOBJ(Mesh *mesh, char *path)
-// {
-// 	std::ofstream file;
-// 	file.open(path);
-
-// 	// write theheader
-// 	file << "# Blender3D v249 OBJ File: " << mesh->name << ".blend\n";
-// 	file << "# www.blender3d.org\n";
-
-// 	// write the vertices
-// 	for (int i = 0; i < mesh->vertices.size(); i++)
-// 	{
-// 		file << "v " << mesh->vertices[i].Position.x << " " << mesh->vertices[i].Position.y << " " << mesh->vertices[i].Position.z << "\n";
-// 	}
-
-// 	// write the normals
-// 	for (int i = 0; i < mesh->vertices.size(); i++)
-// 	{
-// 		file << "vn " << mesh->vertices[i].Normal.x << " " << mesh->vertices[i].Normal.y << " " << mesh->vertices[i].Normal.z << "\n";
-// 	}
-
-// 	// write the faces
-// 	/*
-// 	for(int i=0; i<mesh->triangles.size(); i++)
-// 	{
-// 		file<<"f "<<mesh->triangles[0]<<"//"
-// 	}*/
-
-// 	return true;
-// }
\ No newline at end of file
+// only live vertices and non-degenerate triangles are written, so this
+// exports the mesh at whatever LOD it currently sits at
+bool saveOBJ(const Mesh &mesh, const std::string &path)
+{
+	std::ofstream file(path);
+	if (!file)
+	{
+		std::cerr << "Failed to write OBJ file: " << path << "\n";
+		return false;
+	}
+
+	const auto &positions = mesh.getPositions();
+	const auto &normals = mesh.getNormals();
+	const auto &texCoords = mesh.getTexCoords();
+	const auto &triangles = mesh.getTriangles();
+
+	// dead vertices are skipped, so remap ids to the compacted output order
+	std::vector<int> remap(positions.size(), -1);
+	int next = 0;
+	for (size_t i = 0; i < positions.size(); ++i)
+	{
+		if (mesh.isAlive(i))
+			remap[i] = ++next; // OBJ indices are 1-based
+	}
+
+	file << "# Progressive Meshes export: " << next << " vertices\n";
+
+	for (size_t i = 0; i < positions.size(); ++i)
+		if (mesh.isAlive(i))
+			file << "v " << positions[i].x << " " << positions[i].y << " " << positions[i].z << "\n";
+
+	for (size_t i = 0; i < texCoords.size(); ++i)
+		if (mesh.isAlive(i))
+			file << "vt " << texCoords[i].x << " " << texCoords[i].y << "\n";
+
+	for (size_t i = 0; i < normals.size(); ++i)
+		if (mesh.isAlive(i))
+			file << "vn " << normals[i].x << " " << normals[i].y << " " << normals[i].z << "\n";
+
+	for (const auto &t : triangles)
+	{
+		if (t.isDegenerate())
+			continue;
+
+		int a = remap[t.verts[0]], b = remap[t.verts[1]], c = remap[t.verts[2]];
+		if (a < 0 || b < 0 || c < 0)
+			continue;
+
+		file << "f " << a << "/" << a << "/" << a << " "
+			 << b << "/" << b << "/" << b << " "
+			 << c << "/" << c << "/" << c << "\n";
+	}
+
+	return static_cast<bool>(file);
+}
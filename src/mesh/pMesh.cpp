@@ -1,92 +1,276 @@
 #include <vector>
 
 #include "mesh/pMesh.h"
+#include "mesh/pmFile.h"
+#include "core/Stats.h"
 #include <algorithm>
+#include <cstdlib>
 
 pMesh::pMesh(const Mesh &source, float distance)
-	: original(source)
+	: progressive(std::make_unique<Mesh>(source))
 {
-	for (auto &v : original.getVertices())
-		v.alive = true;
-
-	maxVerts = original.NumVerts();
-	progressive = std::make_unique<Mesh>(original);
+	maxVerts = progressive->NumVerts();
 	Initialize();
 }
 
+pMesh::pMesh(const Mesh &source, const SimplifyOptions &options, const SimplifyProgress &progress)
+	: progressive(std::make_unique<Mesh>(source)),
+	  simplify(options)
+{
+	maxVerts = progressive->NumVerts();
+	Initialize(progress);
+}
+
+pMesh::pMesh(std::vector<Vertex> verts, std::vector<Triangle> tris,
+			 std::vector<pVert> records, std::vector<pFace> changes,
+			 std::vector<pMove> moved)
+	: progressive(std::make_unique<Mesh>(verts, std::move(tris))),
+	  history(std::move(records)),
+	  faces(std::move(changes)),
+	  moves(std::move(moved))
+{
+	// only optimal placement moves vertices
+	if (!moves.empty())
+		progressive->setPlacement(Placement::Optimal);
+	maxVerts = progressive->NumVerts();
+}
+
+pMesh::pMesh(const pmFile &file)
+{
+	const pmHeader &hdr = file.header();
+
+	std::vector<Vertex> verts(hdr.vertexCount);
+	const pmVertex *src = file.vertices();
+	for (uint32_t i = 0; i < hdr.vertexCount; ++i)
+	{
+		verts[i].Position = glm::vec3(src[i].position[0], src[i].position[1], src[i].position[2]);
+		verts[i].Normal = glm::vec3(src[i].normal[0], src[i].normal[1], src[i].normal[2]);
+		verts[i].TexCoords = glm::vec2(src[i].uv[0], src[i].uv[1]);
+	}
+
+	std::vector<Triangle> tris(hdr.triangleCount);
+	const pmTriangle *srcTris = file.triangles();
+	for (uint32_t i = 0; i < hdr.triangleCount; ++i)
+		tris[i] = Triangle(srcTris[i].verts[0], srcTris[i].verts[1], srcTris[i].verts[2]);
+
+	history.assign(file.records(), file.records() + hdr.recordCount);
+	faces.assign(file.faces(), file.faces() + hdr.faceCount);
+	moves.assign(file.moves(), file.moves() + hdr.moveCount);
+
+	progressive = std::make_unique<Mesh>(verts, std::move(tris));
+	// no quadrics on a playback mesh, so this only records it
+	progressive->setPlacement(static_cast<Placement>(hdr.placement));
+	simplify.batchWindow = hdr.batchWindow;
+	maxVerts = progressive->NumVerts();
+}
+
 // pMesh::~pMesh() = default;
 
-void pMesh::Initialize()
+void pMesh::Initialize(const SimplifyProgress &progress)
 {
+	Reset();
 	history.clear();
-	currentHistoryIndex = 0;
+	faces.clear();
+	moves.clear();
+
+	// simplify a scratch copy, the progressive mesh only ever replays the
+	// recorded collapses
+	Mesh work(*progressive);
+	work.ensureSimplification();
+
+	StatScope timer(StatTimer::Simplify);
+	if (simplify.batchWindow > 0.0f)
+		simplifyBatched(work, progress);
+	else
+		simplifyGreedy(work, progress);
+
+	statAdd(Stat::Collapses, history.size());
+	statPeak(StatPeak::QueueSize, work.queueStats().peakSize);
+}
 
-	while (progressive->NumVerts() > 3)
+void pMesh::simplifyGreedy(Mesh &work, const SimplifyProgress &progress)
+{
+	bool recordMoves = work.getPlacement() == Placement::Optimal;
+	const float total = static_cast<float>(std::max(1, work.NumVerts() - 3));
+
+	auto collapse = [&](VertexID u, VertexID v)
 	{
-		VertexID u = progressive->cheapestVertex();
+		uint32_t begin = static_cast<uint32_t>(faces.size());
+		glm::vec3 before = work.getPositions()[v];
+		work.edgeCollapse(u, v, &faces);
+		history.push_back({u, v, begin, static_cast<uint32_t>(faces.size()) - begin});
+		if (recordMoves)
+			moves.push_back({before, work.getPositions()[v]});
+	};
+
+	std::vector<VertexCost> siblings;
+	size_t nextPoll = 0;
+
+	while (work.NumVerts() > 3)
+	{
+		// seam collapses add several records at once, so count past the mark
+		if (progress && history.size() >= nextPoll)
+		{
+			if (!progress(history.size() / total))
+				break;
+			nextPoll = history.size() + 1024;
+		}
+
+		VertexID u = work.cheapestVertex();
 		if (u < 0) {
 			break;
 		}
 
-		VertexID v = progressive->getVertices()[u].destiny;
-		history.push_back({u, v});
-		progressive->edgeCollapse(u, v);
+		// a seam collapse is one record per wedge, in a row
+		VertexID v = work.getDestiny(u);
+		work.seamSiblings(u, v, siblings);
+		collapse(u, v);
+		for (const VertexCost &s : siblings)
+			collapse(s.u, s.v);
 	}
+}
 
-	Reset();
+// collapses of one batch don't share vertices or triangles, so recording
+// them in batch order gives a history that replays like the greedy one
+void pMesh::simplifyBatched(Mesh &work, const SimplifyProgress &progress)
+{
+	bool recordMoves = work.getPlacement() == Placement::Optimal;
+	std::vector<std::vector<pFace>> changed;
+	std::vector<glm::vec3> before;
+	const float total = static_cast<float>(std::max(1, work.NumVerts() - 3));
+
+	while (work.NumVerts() > 3)
+	{
+		if (progress && !progress(history.size() / total))
+			break;
+
+		size_t window = std::max<size_t>(1, static_cast<size_t>(simplify.batchWindow * work.NumVerts()));
+		std::vector<VertexCost> batch = work.selectIndependentCollapses(window, work.NumVerts() - 3);
+		if (batch.empty())
+			break;
+
+		if (recordMoves)
+		{
+			before.clear();
+			for (const VertexCost &c : batch)
+				before.push_back(work.getPositions()[c.v]);
+		}
+
+		work.collapseIndependent(batch, changed);
+
+		for (size_t i = 0; i < batch.size(); ++i)
+		{
+			uint32_t begin = static_cast<uint32_t>(faces.size());
+			faces.insert(faces.end(), changed[i].begin(), changed[i].end());
+			history.push_back({batch[i].u, batch[i].v, begin, static_cast<uint32_t>(changed[i].size())});
+			if (recordMoves)
+				moves.push_back({before[i], work.getPositions()[batch[i].v]});
+		}
+	}
 }
 
-void pMesh::Draw(GLuint programID, const glm::mat4 &MVP)
+void pMesh::applyCollapse(int step)
 {
-	progressive->Draw(programID, MVP);
+	const pVert &h = history[step];
+	auto &tris = progressive->getTriangles();
+	for (uint32_t i = 0; i < h.faceCount; ++i)
+		tris[faces[h.facesBegin + i].tri].collapse(h.from, h.to);
+
+	progressive->setAlive(h.from, false);
+	if (!moves.empty())
+		progressive->setPosition(h.to, moves[step].after);
+
+	if (h.faceCount > 0)
+		progressive->updateIndices(&faces[h.facesBegin], h.faceCount);
+}
+
+void pMesh::applySplit(int step)
+{
+	const pVert &h = history[step];
+	auto &tris = progressive->getTriangles();
+	for (uint32_t i = 0; i < h.faceCount; ++i)
+	{
+		const pFace &f = faces[h.facesBegin + i];
+		tris[f.tri].verts = f.before;
+	}
+
+	progressive->setAlive(h.from, true);
+	if (!moves.empty())
+		progressive->setPosition(h.to, moves[step].before);
+
+	if (h.faceCount > 0)
+		progressive->updateIndices(&faces[h.facesBegin], h.faceCount);
 }
 
 // for split and collapse
 void pMesh::Update(int targetVerts)
 {
+	StatScope timer(StatTimer::Replay);
+	const int start = currentHistoryIndex;
+
 	while (progressive->NumVerts() > targetVerts &&
 		   currentHistoryIndex < history.size())
 	{
-		auto &h = history[currentHistoryIndex++];
-		progressive->edgeCollapse(h.from, h.to);
+		applyCollapse(currentHistoryIndex++);
 	}
 
 	while (progressive->NumVerts() < targetVerts &&
 		   currentHistoryIndex > 0)
 	{
-		auto &h = history[--currentHistoryIndex];
-		progressive->vertexSplit(h.from, h.to);
+		applySplit(--currentHistoryIndex);
 	}
 
-	progressive->updateVBO();
+	statAdd(Stat::ReplaySteps, std::abs(currentHistoryIndex - start));
 }
 
 void pMesh::Reset()
 {
-	progressive = std::make_unique<Mesh>(original);
+	// put moved vertices back, latest collapse first
+	if (!moves.empty())
+		for (int i = currentHistoryIndex - 1; i >= 0; --i)
+			progressive->setPosition(history[i].to, moves[i].before);
+
 	currentHistoryIndex = 0;
 
 	for (auto &tri : progressive->getTriangles())
 		tri.verts = tri.originalVerts;
 
-	progressive->updateVBO();
+	for (VertexID i = 0; i < progressive->TotalVerts(); ++i)
+		progressive->setAlive(i, true);
+
+	progressive->updateIndices();
+}
+
+size_t pMesh::memoryBytes() const
+{
+	return progressive->memoryBytes() + history.capacity() * sizeof(pVert) +
+		   faces.capacity() * sizeof(pFace) + moves.capacity() * sizeof(pMove);
+}
+
+std::vector<Vertex> pMesh::OriginalVertices() const
+{
+	std::vector<Vertex> verts(progressive->TotalVerts());
+	for (VertexID i = 0; i < progressive->TotalVerts(); ++i)
+		verts[i] = progressive->getVertex(i);
+
+	// undo every applied move, latest first
+	for (int i = currentHistoryIndex - 1; i >= 0 && !moves.empty(); --i)
+		verts[history[i].to].Position = moves[i].before;
+
+	return verts;
 }
 
 void pMesh::UpdateToStep(int stepIndex)
 {
 	// clamp index
 	stepIndex = std::clamp(stepIndex, 0, static_cast<int>(history.size()));
+	StatScope timer(StatTimer::Replay);
+	statAdd(Stat::ReplaySteps, std::abs(stepIndex - currentHistoryIndex));
 
-	currentHistoryIndex = 0;
-	progressive = std::make_unique<Mesh>(original);
-
-	// apply collapses up to stepIndex
-	for (int i = 0; i < stepIndex; ++i)
-	{
-		auto &h = history[i];
-		progressive->edgeCollapse(h.from, h.to);
-		currentHistoryIndex++;
-	}
+	// only the steps between here and there, in either direction
+	while (currentHistoryIndex < stepIndex)
+		applyCollapse(currentHistoryIndex++);
 
-	progressive->updateVBO();
-}
\ No newline at end of file
+	while (currentHistoryIndex > stepIndex)
+		applySplit(--currentHistoryIndex);
+}
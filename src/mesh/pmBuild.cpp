@@ -0,0 +1,191 @@
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "mesh/pmBuild.h"
+#include "mesh/pmFile.h"
+
+namespace fs = std::filesystem;
+
+struct pmBuildJob::Shared
+{
+	std::atomic<Phase> phase{Phase::Loading};
+	std::atomic<float> progress{0.0f};
+	std::atomic<bool> cancel{false};
+
+	std::mutex lock;
+	std::unique_ptr<Mesh> mesh;
+	std::unique_ptr<pMesh> progressive;
+
+	// the final phase, unless cancelled meanwhile
+	void finish(Phase result)
+	{
+		phase = cancel ? Phase::Cancelled : result;
+	}
+};
+
+// every job thread that hasn't been joined yet, with its state so it can
+// be cancelled
+struct pmBuildJob::Running
+{
+	std::mutex lock;
+	std::vector<std::pair<std::thread, std::shared_ptr<Shared>>> threads;
+
+	// waitAll() wasn't called; a joinable thread here would terminate
+	~Running()
+	{
+		for (auto &[thread, state] : threads)
+		{
+			state->cancel = true;
+			thread.detach();
+		}
+	}
+};
+
+pmBuildJob::Running &pmBuildJob::running()
+{
+	static Running all;
+	return all;
+}
+
+void pmBuildJob::waitAll()
+{
+	std::vector<std::pair<std::thread, std::shared_ptr<Shared>>> threads;
+	{
+		std::lock_guard<std::mutex> guard(running().lock);
+		threads.swap(running().threads);
+	}
+
+	for (auto &entry : threads)
+		entry.second->cancel = true;
+	for (auto &entry : threads)
+		entry.first.join();
+}
+
+pmBuildJob::pmBuildJob(const std::string &objPath, Placement placement, SimplifyOptions options,
+					   SimplifyProgress progress)
+	: shared(std::make_shared<Shared>()), path(objPath)
+{
+	// the thread holds its own reference to the shared state, so dropping a
+	// job never waits for a large simplification; waitAll() joins it
+	std::thread worker([state = shared, objPath, placement, options, progress]()
+				{
+					fs::path cachePath = fs::path(objPath).replace_extension(".pm");
+
+					std::error_code ec;
+					if (fs::exists(cachePath, ec) &&
+						fs::last_write_time(cachePath, ec) >= fs::last_write_time(objPath, ec))
+					{
+						// only a history built the way this job would build it
+						auto cached = loadPM(cachePath.string());
+						if (cached && cached->getPlacement() == placement &&
+							cached->Options().batchWindow == options.batchWindow)
+						{
+							std::lock_guard<std::mutex> guard(state->lock);
+							state->progressive = std::move(cached);
+							state->progress = 1.0f;
+							state->finish(Phase::Done);
+							return;
+						}
+					}
+
+					Mesh mesh(objPath);
+					mesh.setPlacement(placement);
+					if (mesh.NumVerts() == 0)
+					{
+						state->finish(Phase::Failed);
+						return;
+					}
+
+					// the copy shares every array with `mesh`, simplifying works on its own
+					{
+						std::lock_guard<std::mutex> guard(state->lock);
+						state->mesh = std::make_unique<Mesh>(mesh);
+					}
+					state->phase = Phase::Simplifying;
+
+					// stopped by cancel() or by the caller's progress, either way the
+					// history is incomplete and must not be cached or handed out
+					bool stopped = false;
+					auto progressive = std::make_unique<pMesh>(mesh, options, [&](float done)
+															   {
+																   state->progress = done;
+																   stopped = state->cancel || (progress && !progress(done));
+																   return !stopped; });
+					if (stopped || state->cancel)
+					{
+						state->phase = Phase::Cancelled;
+						return;
+					}
+
+					// written next to the cache and renamed over it, so an
+					// interrupted save never leaves a truncated .pm that looks current
+					static std::atomic<unsigned> saves{0};
+					fs::path partial = cachePath;
+					partial += ".part" + std::to_string(saves++);
+					if (savePM(*progressive, partial.string()))
+						fs::rename(partial, cachePath, ec);
+					else
+						ec = std::make_error_code(std::errc::io_error);
+					if (ec)
+						fs::remove(partial, ec);
+
+					std::lock_guard<std::mutex> guard(state->lock);
+					state->progressive = std::move(progressive);
+					state->progress = 1.0f;
+					state->finish(Phase::Done); });
+
+	std::lock_guard<std::mutex> guard(running().lock);
+	auto &threads = running().threads;
+	// join the ones that have finished so the list stays short
+	for (size_t i = 0; i < threads.size();)
+	{
+		Phase p = threads[i].second->phase;
+		if (p == Phase::Done || p == Phase::Cancelled || p == Phase::Failed)
+		{
+			threads[i].first.join();
+			threads.erase(threads.begin() + i);
+		}
+		else
+			++i;
+	}
+	threads.emplace_back(std::move(worker), shared);
+}
+
+pmBuildJob::~pmBuildJob()
+{
+	shared->cancel = true;
+}
+
+void pmBuildJob::cancel()
+{
+	shared->cancel = true;
+}
+
+pmBuildJob::Phase pmBuildJob::phase() const
+{
+	return shared->phase;
+}
+
+float pmBuildJob::Progress() const
+{
+	return shared->progress;
+}
+
+std::unique_ptr<Mesh> pmBuildJob::takeMesh()
+{
+	std::lock_guard<std::mutex> guard(shared->lock);
+	return std::move(shared->mesh);
+}
+
+std::unique_ptr<pMesh> pmBuildJob::takeProgressive()
+{
+	std::lock_guard<std::mutex> guard(shared->lock);
+	if (shared->phase != Phase::Done)
+		return nullptr;
+	return std::move(shared->progressive);
+}
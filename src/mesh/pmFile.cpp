@@ -0,0 +1,171 @@
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "mesh/pmFile.h"
+
+namespace
+{
+	constexpr uint64_t kAlign = 16;
+
+	uint64_t alignUp(uint64_t n)
+	{
+		return (n + kAlign - 1) & ~(kAlign - 1);
+	}
+
+	bool sectionFits(uint64_t offset, uint64_t count, uint64_t stride, uint64_t fileSize)
+	{
+		return offset % kAlign == 0 && offset <= fileSize &&
+			   count <= (fileSize - offset) / stride;
+	}
+
+	void writePadded(std::ofstream &out, const void *data, uint64_t bytes, uint64_t &pos)
+	{
+		static const char zeros[kAlign] = {};
+		out.write(static_cast<const char *>(data), bytes);
+		pos += bytes;
+
+		uint64_t pad = alignUp(pos) - pos;
+		out.write(zeros, pad);
+		pos += pad;
+	}
+}
+
+bool pmFile::open(const std::string &path)
+{
+	hdr = nullptr;
+	if (!file.open(path))
+		return false;
+
+	if (file.size() < sizeof(pmHeader))
+		return false;
+
+	hdr = reinterpret_cast<const pmHeader *>(file.data());
+	if (!validate())
+	{
+		hdr = nullptr;
+		file.close();
+		return false;
+	}
+
+	return true;
+}
+
+bool pmFile::validate() const
+{
+	if (std::memcmp(hdr->magic, kPMMagic, sizeof(kPMMagic)) != 0)
+		return false;
+	if (hdr->version != kPMVersion)
+	{
+		std::cerr << "Unsupported .pm version " << hdr->version << "\n";
+		return false;
+	}
+
+	uint64_t size = file.size();
+	if (!sectionFits(hdr->vertexOffset, hdr->vertexCount, sizeof(pmVertex), size) ||
+		!sectionFits(hdr->triangleOffset, hdr->triangleCount, sizeof(pmTriangle), size) ||
+		!sectionFits(hdr->recordOffset, hdr->recordCount, sizeof(pVert), size) ||
+		!sectionFits(hdr->faceOffset, hdr->faceCount, sizeof(pFace), size) ||
+		!sectionFits(hdr->moveOffset, hdr->moveCount, sizeof(pMove), size))
+		return false;
+	if (hdr->moveCount != 0 && hdr->moveCount != hdr->recordCount)
+		return false;
+	if (hdr->placement > static_cast<uint32_t>(Placement::Optimal))
+		return false;
+
+	// indices are trusted from here on, so check them once
+	auto validVert = [&](int32_t v)
+	{ return v >= 0 && static_cast<uint32_t>(v) < hdr->vertexCount; };
+
+	const pmTriangle *tris = triangles();
+	for (uint32_t i = 0; i < hdr->triangleCount; ++i)
+		if (!validVert(tris[i].verts[0]) || !validVert(tris[i].verts[1]) || !validVert(tris[i].verts[2]))
+			return false;
+
+	const pVert *recs = records();
+	for (uint32_t i = 0; i < hdr->recordCount; ++i)
+	{
+		if (!validVert(recs[i].from) || !validVert(recs[i].to))
+			return false;
+		if (recs[i].facesBegin > hdr->faceCount || recs[i].faceCount > hdr->faceCount - recs[i].facesBegin)
+			return false;
+	}
+
+	const pFace *fs = faces();
+	for (uint32_t i = 0; i < hdr->faceCount; ++i)
+	{
+		if (fs[i].tri < 0 || static_cast<uint32_t>(fs[i].tri) >= hdr->triangleCount)
+			return false;
+		for (VertexID v : fs[i].before)
+			if (!validVert(v))
+				return false;
+	}
+
+	return true;
+}
+
+bool savePM(const pMesh &pm, const std::string &path)
+{
+	std::ofstream out(path, std::ios::binary);
+	if (!out)
+	{
+		std::cerr << "Failed to write .pm file: " << path << "\n";
+		return false;
+	}
+
+	const Mesh &mesh = pm.Current();
+	const auto &tris = mesh.getTriangles();
+
+	const std::vector<Vertex> verts = pm.OriginalVertices();
+	std::vector<pmVertex> vertexData(verts.size());
+	for (size_t i = 0; i < verts.size(); ++i)
+	{
+		const Vertex &v = verts[i];
+		vertexData[i] = {{v.Position.x, v.Position.y, v.Position.z},
+						 {v.Normal.x, v.Normal.y, v.Normal.z},
+						 {v.TexCoords.x, v.TexCoords.y}};
+	}
+
+	// always store the full resolution triangles, whatever LOD pm is at
+	std::vector<pmTriangle> triangleData(tris.size());
+	for (size_t i = 0; i < tris.size(); ++i)
+		for (int k = 0; k < 3; ++k)
+			triangleData[i].verts[k] = tris[i].originalVerts[k];
+
+	pmHeader hdr{};
+	std::memcpy(hdr.magic, kPMMagic, sizeof(kPMMagic));
+	hdr.version = kPMVersion;
+	hdr.vertexCount = static_cast<uint32_t>(vertexData.size());
+	hdr.triangleCount = static_cast<uint32_t>(triangleData.size());
+	hdr.recordCount = static_cast<uint32_t>(pm.History().size());
+	hdr.faceCount = static_cast<uint32_t>(pm.Faces().size());
+	hdr.moveCount = static_cast<uint32_t>(pm.Moves().size());
+	hdr.placement = static_cast<uint32_t>(pm.getPlacement());
+	hdr.batchWindow = pm.Options().batchWindow;
+
+	hdr.vertexOffset = alignUp(sizeof(pmHeader));
+	hdr.triangleOffset = alignUp(hdr.vertexOffset + uint64_t(hdr.vertexCount) * sizeof(pmVertex));
+	hdr.recordOffset = alignUp(hdr.triangleOffset + uint64_t(hdr.triangleCount) * sizeof(pmTriangle));
+	hdr.faceOffset = alignUp(hdr.recordOffset + uint64_t(hdr.recordCount) * sizeof(pVert));
+	hdr.moveOffset = alignUp(hdr.faceOffset + uint64_t(hdr.faceCount) * sizeof(pFace));
+
+	uint64_t pos = 0;
+	writePadded(out, &hdr, sizeof(hdr), pos);
+	writePadded(out, vertexData.data(), vertexData.size() * sizeof(pmVertex), pos);
+	writePadded(out, triangleData.data(), triangleData.size() * sizeof(pmTriangle), pos);
+	writePadded(out, pm.History().data(), pm.History().size() * sizeof(pVert), pos);
+	writePadded(out, pm.Faces().data(), pm.Faces().size() * sizeof(pFace), pos);
+	writePadded(out, pm.Moves().data(), pm.Moves().size() * sizeof(pMove), pos);
+
+	return static_cast<bool>(out);
+}
+
+std::unique_ptr<pMesh> loadPM(const std::string &path)
+{
+	pmFile file;
+	if (!file.open(path))
+		return nullptr;
+
+	return std::make_unique<pMesh>(file);
+}
@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <cmath>
+
+#include "mesh/pmLayout.h"
+
+const pmLevel &levelFor(const std::vector<pmLevel> &levels, int step)
+{
+	auto it = std::lower_bound(levels.begin(), levels.end(), step,
+							   [](const pmLevel &l, int s)
+							   { return static_cast<int>(l.step) < s; });
+	return it == levels.end() ? levels.back() : *it;
+}
+
+pmLayout buildPrefixLayout(const pMesh &pm, float levelRatio)
+{
+	pmLayout layout;
+
+	const std::vector<pVert> &history = pm.History();
+	const std::vector<pFace> &faces = pm.Faces();
+	const std::vector<pMove> &moves = pm.Moves();
+	const int steps = pm.HistorySize();
+
+	std::vector<Vertex> verts = pm.OriginalVertices();
+	const uint32_t total = static_cast<uint32_t>(verts.size());
+	const uint32_t baseCount = total - static_cast<uint32_t>(steps);
+
+	// split order: vertices never collapsed keep their relative order, then
+	// the latest collapse's vertex, and so on back to the first
+	layout.rank.assign(total, 0);
+	std::vector<char> collapsed(total, 0);
+	for (const pVert &h : history)
+		collapsed[h.from] = 1;
+	uint32_t next = 0;
+	for (uint32_t v = 0; v < total; ++v)
+		if (!collapsed[v])
+			layout.rank[v] = next++;
+	for (int i = 0; i < steps; ++i)
+		layout.rank[history[i].from] = total - 1 - i;
+
+	// replay once to find the step that removes each triangle; live at step
+	// n means removed at a step >= n, so `steps` is never removed and -1
+	// was never drawn
+	std::vector<Triangle> tris = pm.Current().getTriangles();
+	std::vector<int> removedAt(tris.size());
+	for (size_t t = 0; t < tris.size(); ++t)
+	{
+		tris[t].verts = tris[t].originalVerts;
+		removedAt[t] = tris[t].isDegenerate() ? -1 : steps;
+	}
+	for (int i = 0; i < steps; ++i)
+	{
+		const pVert &h = history[i];
+		for (uint32_t f = 0; f < h.faceCount; ++f)
+		{
+			Triangle &tri = tris[faces[h.facesBegin + f].tri];
+			tri.collapse(h.from, h.to);
+			if (tri.isDegenerate() && removedAt[faces[h.facesBegin + f].tri] == steps)
+				removedAt[faces[h.facesBegin + f].tri] = i;
+		}
+	}
+
+	std::vector<TriangleID> faceOrder(tris.size());
+	for (size_t t = 0; t < tris.size(); ++t)
+		faceOrder[t] = static_cast<TriangleID>(t);
+	std::stable_sort(faceOrder.begin(), faceOrder.end(), [&](TriangleID a, TriangleID b)
+					 { return removedAt[a] > removedAt[b]; });
+
+	// level steps, geometric in vertex count and always ending on the base
+	std::vector<uint32_t> levelSteps{0};
+	levelRatio = std::clamp(levelRatio, 0.05f, 0.99f);
+	double count = total;
+	while (levelSteps.back() < static_cast<uint32_t>(steps))
+	{
+		count *= levelRatio;
+		uint32_t step = total - std::max<uint32_t>(baseCount, static_cast<uint32_t>(std::lround(count)));
+		levelSteps.push_back(std::max(step, levelSteps.back() + 1));
+	}
+
+	// every level's vertices and indices, walking the history forwards again
+	for (size_t t = 0; t < tris.size(); ++t)
+		tris[t].verts = tris[t].originalVerts;
+
+	const bool moving = pm.MovesVertices();
+	std::vector<Vertex> ordered(total);
+	auto emitVertices = [&](uint32_t vertexCount)
+	{
+		for (uint32_t v = 0; v < total; ++v)
+			if (layout.rank[v] < vertexCount)
+				ordered[layout.rank[v]] = verts[v];
+		layout.vertices.insert(layout.vertices.end(), ordered.begin(), ordered.begin() + vertexCount);
+	};
+	if (!moving)
+		emitVertices(total);
+
+	size_t liveFaces = faceOrder.size();
+	int replayed = 0;
+	float error = 0.0f;
+	for (uint32_t step : levelSteps)
+	{
+		for (; replayed < static_cast<int>(step); ++replayed)
+		{
+			const pVert &h = history[replayed];
+			glm::vec3 fromPos = verts[h.from].Position;
+			glm::vec3 toPos = verts[h.to].Position;
+			for (uint32_t f = 0; f < h.faceCount; ++f)
+				tris[faces[h.facesBegin + f].tri].collapse(h.from, h.to);
+			if (moving)
+				verts[h.to].Position = moves[replayed].after;
+
+			for (uint32_t f = 0; f < h.faceCount; ++f)
+			{
+				const Triangle &t = tris[faces[h.facesBegin + f].tri];
+				if (t.isDegenerate())
+					continue;
+				const glm::vec3 &a = verts[t.verts[0]].Position;
+				glm::vec3 n = glm::cross(verts[t.verts[1]].Position - a, verts[t.verts[2]].Position - a);
+				float length = glm::length(n);
+				if (length < 1e-12f)
+					continue;
+				n /= length;
+				error = std::max({error, std::abs(glm::dot(n, fromPos - a)), std::abs(glm::dot(n, toPos - a))});
+			}
+		}
+		while (liveFaces > 0 && removedAt[faceOrder[liveFaces - 1]] < static_cast<int>(step))
+			--liveFaces;
+
+		pmLevel level;
+		level.step = step;
+		level.vertexCount = total - step;
+		level.baseVertex = moving ? static_cast<uint32_t>(layout.vertices.size()) : 0;
+		level.firstIndex = static_cast<uint32_t>(layout.indices.size());
+		level.indexCount = static_cast<uint32_t>(liveFaces * 3);
+		level.error = error;
+
+		if (moving)
+			emitVertices(level.vertexCount);
+		for (size_t f = 0; f < liveFaces; ++f)
+			for (VertexID v : tris[faceOrder[f]].verts)
+				layout.indices.push_back(layout.rank[v]);
+
+		layout.levels.push_back(level);
+	}
+
+	return layout;
+}
@@ -0,0 +1,447 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#include "mesh/pmStream.h"
+
+#ifdef _WIN32
+#include <io.h>
+#define readFD _read
+#else
+#include <unistd.h>
+#define readFD ::read
+#endif
+
+namespace
+{
+	pmVertex packVertex(const Vertex &v)
+	{
+		return {{v.Position.x, v.Position.y, v.Position.z},
+				{v.Normal.x, v.Normal.y, v.Normal.z},
+				{v.TexCoords.x, v.TexCoords.y}};
+	}
+
+	Vertex unpackVertex(const pmVertex &src)
+	{
+		Vertex v;
+		v.Position = glm::vec3(src.position[0], src.position[1], src.position[2]);
+		v.Normal = glm::vec3(src.normal[0], src.normal[1], src.normal[2]);
+		v.TexCoords = glm::vec2(src.uv[0], src.uv[1]);
+		return v;
+	}
+
+	template <typename T>
+	void writeRaw(std::ofstream &out, const T &value)
+	{
+		out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+	}
+}
+
+#pragma region Writer
+bool savePMStream(const pMesh &pm, const std::string &path)
+{
+	std::ofstream out(path, std::ios::binary);
+	if (!out)
+	{
+		std::cerr << "Failed to write .pms file: " << path << "\n";
+		return false;
+	}
+
+	const Mesh &mesh = pm.Current();
+	const auto &tris = pm.Current().getTriangles();
+	const auto &history = pm.History();
+	const auto &faces = pm.Faces();
+
+	// replay every collapse on a scratch copy to find the base mesh
+	std::vector<Triangle> base(tris.size());
+	for (size_t i = 0; i < tris.size(); ++i)
+		base[i].verts = tris[i].originalVerts;
+
+	// and, with optimal placement, where every vertex sits at each step
+	std::vector<Vertex> verts = pm.OriginalVertices();
+	std::vector<Vertex> removed(history.size());
+	std::vector<char> alive(mesh.TotalVerts(), 1);
+	for (size_t k = 0; k < history.size(); ++k)
+	{
+		const pVert &h = history[k];
+		for (uint32_t i = 0; i < h.faceCount; ++i)
+			base[faces[h.facesBegin + i].tri].collapse(h.from, h.to);
+		alive[h.from] = 0;
+		removed[k] = verts[h.from];
+		if (!pm.Moves().empty())
+			verts[h.to].Position = pm.Moves()[k].after;
+	}
+
+	std::vector<pmStreamVertex> baseVerts;
+	for (VertexID i = 0; i < mesh.TotalVerts(); ++i)
+		if (alive[i])
+			baseVerts.push_back({i, packVertex(verts[i])});
+
+	// degenerate triangles are skipped, the split that revives one restores
+	// all of its corners
+	std::vector<pFace> baseTris;
+	for (size_t i = 0; i < base.size(); ++i)
+		if (!base[i].isDegenerate())
+			baseTris.push_back({static_cast<TriangleID>(i), base[i].verts});
+
+	pmStreamHeader hdr{};
+	std::memcpy(hdr.magic, kPMStreamMagic, sizeof(kPMStreamMagic));
+	hdr.version = kPMStreamVersion;
+	hdr.vertexCount = static_cast<uint32_t>(mesh.TotalVerts());
+	hdr.triangleCount = static_cast<uint32_t>(tris.size());
+	hdr.baseVertexCount = static_cast<uint32_t>(baseVerts.size());
+	hdr.baseTriangleCount = static_cast<uint32_t>(baseTris.size());
+	hdr.recordCount = static_cast<uint32_t>(history.size());
+
+	writeRaw(out, hdr);
+	out.write(reinterpret_cast<const char *>(baseVerts.data()), baseVerts.size() * sizeof(pmStreamVertex));
+	out.write(reinterpret_cast<const char *>(baseTris.data()), baseTris.size() * sizeof(pFace));
+
+	// splits undo the collapses, so they go out in reverse
+	for (size_t k = history.size(); k-- > 0;)
+	{
+		const pVert &h = history[k];
+		glm::vec3 to = pm.Moves().empty() ? verts[h.to].Position : pm.Moves()[k].before;
+
+		pmStreamSplit split{h.from, h.to, h.faceCount, packVertex(removed[k]), {to.x, to.y, to.z}};
+		writeRaw(out, split);
+		out.write(reinterpret_cast<const char *>(faces.data() + h.facesBegin), h.faceCount * sizeof(pFace));
+	}
+
+	return static_cast<bool>(out);
+}
+#pragma endregion
+
+#pragma region Decoder
+void pmStreamDecoder::feed(const char *data, size_t size)
+{
+	if (state == State::Failed || state == State::Done || size == 0)
+		return;
+
+	// drop what has already been consumed before growing the buffer
+	if (readPos > 0)
+	{
+		pending.erase(pending.begin(), pending.begin() + readPos);
+		readPos = 0;
+	}
+
+	pending.insert(pending.end(), data, data + size);
+	received += size;
+	parse();
+}
+
+void pmStreamDecoder::finish()
+{
+	if (state != State::Done && state != State::Failed)
+		fail(baseReady ? "truncated in the splits" : "truncated before the base mesh");
+}
+
+void pmStreamDecoder::fail(const char *why)
+{
+	std::cerr << "Invalid .pms stream: " << why << "\n";
+	state = State::Failed;
+	pending.clear();
+	readPos = 0;
+}
+
+void pmStreamDecoder::parse()
+{
+	auto available = [&]()
+	{ return pending.size() - readPos; };
+	auto take = [&](void *dst, size_t n)
+	{
+		std::memcpy(dst, pending.data() + readPos, n);
+		readPos += n;
+	};
+
+	while (true)
+	{
+		switch (state)
+		{
+		case State::Header:
+		{
+			if (available() < sizeof(pmStreamHeader))
+				return;
+
+			take(&header, sizeof(header));
+			if (std::memcmp(header.magic, kPMStreamMagic, sizeof(kPMStreamMagic)) != 0)
+				return fail("bad magic");
+			if (header.version != kPMStreamVersion)
+				return fail("unsupported version");
+			if (header.baseVertexCount > header.vertexCount || header.baseTriangleCount > header.triangleCount)
+				return fail("bad base counts");
+
+			// every vertex starts dead, the base section and splits revive them
+			std::vector<Vertex> verts(header.vertexCount);
+			std::vector<Triangle> tris(header.triangleCount);
+			mesh = std::make_unique<Mesh>(verts, std::move(tris));
+			for (VertexID i = 0; i < static_cast<VertexID>(header.vertexCount); ++i)
+				mesh->setAlive(i, false);
+
+			// hold the mesh back until the base section is complete
+			itemsLeft = header.baseVertexCount;
+			state = State::BaseVertices;
+			break;
+		}
+
+		case State::BaseVertices:
+		{
+			while (itemsLeft > 0 && available() >= sizeof(pmStreamVertex))
+			{
+				pmStreamVertex v;
+				take(&v, sizeof(v));
+				if (!validVert(v.id))
+					return fail("base vertex out of range");
+
+				mesh->setVertex(v.id, unpackVertex(v.attr));
+				mesh->setAlive(v.id, true);
+				itemsLeft--;
+			}
+			if (itemsLeft > 0)
+				return;
+
+			itemsLeft = header.baseTriangleCount;
+			state = State::BaseTriangles;
+			break;
+		}
+
+		case State::BaseTriangles:
+		{
+			auto &tris = mesh->getTriangles();
+			while (itemsLeft > 0 && available() >= sizeof(pFace))
+			{
+				pFace f;
+				take(&f, sizeof(f));
+				if (!validTri(f.tri) || !validVert(f.before[0]) || !validVert(f.before[1]) || !validVert(f.before[2]))
+					return fail("base triangle out of range");
+
+				tris[f.tri].verts = f.before;
+				itemsLeft--;
+			}
+			if (itemsLeft > 0)
+				return;
+
+			mesh->updateIndices();
+			verticesDirty = true;
+			baseReady = true;
+			itemsLeft = header.recordCount;
+			state = itemsLeft > 0 ? State::SplitHeader : State::Done;
+			break;
+		}
+
+		case State::SplitHeader:
+		{
+			if (available() < sizeof(pmStreamSplit))
+				return;
+
+			take(&currentSplit, sizeof(currentSplit));
+			if (!validVert(currentSplit.from) || !validVert(currentSplit.to))
+				return fail("split vertex out of range");
+
+			// safe to write now, the vertex stays dead until the split is applied
+			mesh->setVertex(currentSplit.from, unpackVertex(currentSplit.attr));
+			splits.push_back({currentSplit.from, currentSplit.to,
+							  static_cast<uint32_t>(faces.size()), currentSplit.faceCount});
+			const float *p = currentSplit.toPosition;
+			moves.push_back({glm::vec3(p[0], p[1], p[2]), glm::vec3(0.0f)});
+			state = State::SplitFaces;
+			break;
+		}
+
+		case State::SplitFaces:
+		{
+			pVert &s = splits.back();
+			while (faces.size() - s.facesBegin < s.faceCount && available() >= sizeof(pFace))
+			{
+				pFace f;
+				take(&f, sizeof(f));
+				if (!validTri(f.tri) || !validVert(f.before[0]) || !validVert(f.before[1]) || !validVert(f.before[2]))
+					return fail("split face out of range");
+				faces.push_back(f);
+			}
+			if (faces.size() - s.facesBegin < s.faceCount)
+				return;
+
+			splitsReady++;
+			itemsLeft--;
+			state = itemsLeft > 0 ? State::SplitHeader : State::Done;
+			break;
+		}
+
+		case State::Done:
+		case State::Failed:
+			pending.clear();
+			readPos = 0;
+			return;
+		}
+	}
+}
+
+int pmStreamDecoder::refine(int maxSplits, double budgetMs)
+{
+	if (!baseReady)
+		return 0;
+
+	using clock = std::chrono::steady_clock;
+	auto start = clock::now();
+	auto &tris = mesh->getTriangles();
+
+	int count = 0;
+	while (applied < splitsReady && count < maxSplits)
+	{
+		// reading the clock every split would cost more than the split itself
+		if (budgetMs > 0.0 && (count & 15) == 15 &&
+			std::chrono::duration<double, std::milli>(clock::now() - start).count() >= budgetMs)
+			break;
+
+		const pVert &s = splits[applied++];
+		for (uint32_t i = 0; i < s.faceCount; ++i)
+		{
+			const pFace &f = faces[s.facesBegin + i];
+			tris[f.tri].verts = f.before;
+		}
+		mesh->setAlive(s.from, true);
+		if (s.faceCount > 0)
+			mesh->updateIndices(&faces[s.facesBegin], s.faceCount);
+
+		pMove &m = moves[applied - 1];
+		m.after = mesh->getPositions()[s.to];
+		mesh->setPosition(s.to, m.before);
+		count++;
+	}
+
+	if (count > 0)
+		verticesDirty = true;
+
+	return count;
+}
+
+bool pmStreamDecoder::complete() const
+{
+	return state == State::Done && applied == splitsReady;
+}
+
+std::unique_ptr<pMesh> pmStreamDecoder::takeProgressive()
+{
+	if (!complete())
+		return nullptr;
+
+	// at full resolution, so the current corners are the original ones
+	std::vector<Vertex> verts(mesh->TotalVerts());
+	for (VertexID i = 0; i < mesh->TotalVerts(); ++i)
+		verts[i] = mesh->getVertex(i);
+	std::vector<Triangle> tris = std::move(mesh->getTriangles());
+	for (auto &t : tris)
+		t.originalVerts = t.verts;
+
+	// collapse order is the reverse of the split order
+	std::vector<pVert> history;
+	std::vector<pFace> changes;
+	history.reserve(splits.size());
+	changes.reserve(faces.size());
+	for (auto it = splits.rbegin(); it != splits.rend(); ++it)
+	{
+		history.push_back({it->from, it->to, static_cast<uint32_t>(changes.size()), it->faceCount});
+		changes.insert(changes.end(), faces.begin() + it->facesBegin,
+					   faces.begin() + it->facesBegin + it->faceCount);
+	}
+
+	// half-edge streams never move a vertex, keep them move-free
+	std::vector<pMove> moved(moves.rbegin(), moves.rend());
+	bool anyMoved = std::any_of(moved.begin(), moved.end(), [](const pMove &m)
+								{ return m.before != m.after; });
+	if (!anyMoved)
+		moved.clear();
+
+	mesh.reset();
+	baseReady = false;
+	splits.clear();
+	faces.clear();
+	moves.clear();
+	applied = splitsReady = 0;
+
+	return std::make_unique<pMesh>(std::move(verts), std::move(tris),
+								   std::move(history), std::move(changes), std::move(moved));
+}
+#pragma endregion
+
+#pragma region Reader
+struct pmStreamReader::Shared
+{
+	std::mutex lock;
+	std::vector<char> buffer;
+	bool done = false;
+	bool error = false;
+	std::atomic<bool> stop{false};
+};
+
+pmStreamReader::pmStreamReader(const std::string &path)
+	: shared(std::make_shared<Shared>())
+{
+	// the thread owns a reference to the shared state and is detached, so a
+	// pipe that never closes can't block the destructor
+	std::thread([state = shared, path]()
+				{
+					FILE *in = path == "-" ? stdin : std::fopen(path.c_str(), "rb");
+					if (!in)
+					{
+						std::lock_guard<std::mutex> guard(state->lock);
+						state->error = state->done = true;
+						return;
+					}
+
+					// read() rather than fread() so bytes are handed on as soon as
+					// the pipe has some, instead of once a whole chunk is filled
+					int fd = fileno(in);
+					std::vector<char> chunk(64 * 1024);
+					while (!state->stop)
+					{
+						auto n = readFD(fd, chunk.data(), static_cast<unsigned>(chunk.size()));
+						if (n <= 0)
+						{
+							std::lock_guard<std::mutex> guard(state->lock);
+							state->error = n < 0;
+							break;
+						}
+
+						std::lock_guard<std::mutex> guard(state->lock);
+						state->buffer.insert(state->buffer.end(), chunk.data(), chunk.data() + n);
+					}
+
+					if (in != stdin)
+						std::fclose(in);
+
+					std::lock_guard<std::mutex> guard(state->lock);
+					state->done = true; })
+		.detach();
+}
+
+pmStreamReader::~pmStreamReader()
+{
+	shared->stop = true;
+}
+
+bool pmStreamReader::poll()
+{
+	std::vector<char> arrived;
+	bool error, done;
+	{
+		std::lock_guard<std::mutex> guard(shared->lock);
+		arrived.swap(shared->buffer);
+		error = shared->error;
+		// taken with the buffer, so these are the last bytes when it is set
+		done = shared->done;
+	}
+
+	dec.feed(arrived.data(), arrived.size());
+	if (done && !error)
+		dec.finish();
+	return !error && !dec.failed();
+}
+#pragma endregion
@@ -0,0 +1,240 @@
+#include <algorithm>
+#include <cstddef> /* offsetof */
+
+#include <glm/gtc/packing.hpp>
+
+#include "core/Stats.h"
+#include "render/MeshRenderer.h"
+
+MeshRenderer::~MeshRenderer()
+{
+	destroyGL();
+}
+
+// every buffer write goes through here, for the upload counters
+static void bufferSubData(GLenum target, size_t offset, size_t bytes, const void *data)
+{
+	glBufferSubData(target, offset, bytes, data);
+	statAdd(Stat::BytesUploaded, bytes);
+	statAdd(Stat::Uploads);
+}
+
+static void bufferData(GLenum target, size_t bytes, const void *data, GLenum usage)
+{
+	glBufferData(target, bytes, data, usage);
+	if (data)
+	{
+		statAdd(Stat::BytesUploaded, bytes);
+		statAdd(Stat::Uploads);
+	}
+}
+
+static RenderVertex packVertex(const glm::vec3 &position, const glm::vec3 &normal, const glm::vec2 &texCoords)
+{
+	RenderVertex rv;
+	rv.position[0] = position.x;
+	rv.position[1] = position.y;
+	rv.position[2] = position.z;
+	rv.normal = glm::packSnorm3x10_1x2(glm::vec4(normal.x, normal.y, normal.z, 0.0f));
+	rv.texCoords = glm::packHalf2x16(texCoords);
+	return rv;
+}
+
+void MeshRenderer::packVertices(const Mesh &mesh)
+{
+	const auto &positions = mesh.getPositions();
+	const auto &normals = mesh.getNormals();
+	const auto &texCoords = mesh.getTexCoords();
+
+	packed.resize(positions.size());
+	for (size_t i = 0; i < positions.size(); ++i)
+		packed[i] = packVertex(positions[i], normals[i], texCoords[i]);
+}
+
+void MeshRenderer::Upload(const Mesh &mesh)
+{
+	StatScope timer(StatTimer::Upload);
+	packVertices(mesh);
+	createGL();
+
+	indexCapacity = 0;
+	uploadAllIndices(mesh);
+	levels.clear();
+
+	glBindVertexArray(0);
+}
+
+void MeshRenderer::UploadLayout(const pmLayout &layout)
+{
+	StatScope timer(StatTimer::Upload);
+	packed.resize(layout.vertices.size());
+	for (size_t i = 0; i < layout.vertices.size(); ++i)
+	{
+		const Vertex &v = layout.vertices[i];
+		packed[i] = packVertex(v.Position, v.Normal, v.TexCoords);
+	}
+	createGL();
+
+	// nothing is written after this, each level is a range of the one buffer
+	bufferData(GL_ELEMENT_ARRAY_BUFFER, layout.indices.size() * sizeof(GLuint),
+				 layout.indices.data(), GL_STATIC_DRAW);
+	indexCapacity = 0;
+
+	levels = layout.levels;
+	drawLevel = levels.front();
+
+	glBindVertexArray(0);
+}
+
+int MeshRenderer::SelectStep(int step)
+{
+	drawLevel = levelFor(levels, step);
+	return static_cast<int>(drawLevel.vertexCount);
+}
+
+// fresh VAO/VBO/EBO with `packed` as the vertices. The VAO is left bound
+// so the caller can fill the EBO
+void MeshRenderer::createGL()
+{
+	destroyGL();
+
+	glGenVertexArrays(1, &this->VAO);
+	glGenBuffers(1, &this->VBO);
+	glGenBuffers(1, &this->EBO);
+
+	glBindVertexArray(this->VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
+
+	bufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(RenderVertex),
+			   packed.data(), GL_STATIC_DRAW);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->EBO);
+
+	// Vertex Positions
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(RenderVertex),
+						  (GLvoid *)offsetof(RenderVertex, position));
+	// Vertex Normals, packed formats must be given 4 components
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(RenderVertex),
+						  (GLvoid *)offsetof(RenderVertex, normal));
+	// Vertex Texture Coords
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(RenderVertex),
+						  (GLvoid *)offsetof(RenderVertex, texCoords));
+}
+
+void MeshRenderer::UpdateIndices(const Mesh &mesh)
+{
+	StatScope timer(StatTimer::Upload);
+	const auto &indices = mesh.getIndices();
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->EBO);
+	if (indices.size() > indexCapacity || !mesh.indexChangesSince(indexVersion, dirtySlots))
+	{
+		uploadAllIndices(mesh);
+		return;
+	}
+
+	// slots past the end are not drawn, whatever the buffer holds there
+	size_t slotCount = indices.size() / 3;
+	std::sort(dirtySlots.begin(), dirtySlots.end());
+	dirtySlots.erase(std::unique(dirtySlots.begin(), dirtySlots.end()), dirtySlots.end());
+	dirtySlots.erase(std::lower_bound(dirtySlots.begin(), dirtySlots.end(), slotCount), dirtySlots.end());
+
+	// runs of nearby slots go up together, a few clean slots in between cost
+	// less than another call
+	const uint32_t maxGap = 16;
+	for (size_t i = 0; i < dirtySlots.size();)
+	{
+		uint32_t first = dirtySlots[i];
+		uint32_t last = first;
+		while (++i < dirtySlots.size() && dirtySlots[i] - last <= maxGap)
+			last = dirtySlots[i];
+
+		bufferSubData(GL_ELEMENT_ARRAY_BUFFER, first * 3 * sizeof(GLuint),
+					  (last - first + 1) * 3 * sizeof(GLuint), indices.data() + first * 3);
+	}
+
+	indexCount = static_cast<GLsizei>(indices.size());
+	indexVersion = mesh.indexVersion();
+}
+
+// expects the EBO bound
+void MeshRenderer::uploadAllIndices(const Mesh &mesh)
+{
+	const auto &indices = mesh.getIndices();
+
+	size_t capacity = std::max(indices.size(), mesh.getTriangles().size() * 3);
+	if (capacity > indexCapacity)
+	{
+		bufferData(GL_ELEMENT_ARRAY_BUFFER, capacity * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+		indexCapacity = capacity;
+	}
+	bufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indices.size() * sizeof(GLuint), indices.data());
+
+	indexCount = static_cast<GLsizei>(indices.size());
+	indexVersion = mesh.indexVersion();
+}
+
+void MeshRenderer::UpdateVertices(const Mesh &mesh)
+{
+	StatScope timer(StatTimer::Upload);
+	packVertices(mesh);
+
+	glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
+	bufferSubData(GL_ARRAY_BUFFER, 0, packed.size() * sizeof(RenderVertex), packed.data());
+}
+
+void MeshRenderer::destroyGL()
+{
+	if (VAO)
+		glDeleteVertexArrays(1, &VAO);
+	if (VBO)
+		glDeleteBuffers(1, &VBO);
+	if (EBO)
+		glDeleteBuffers(1, &EBO);
+
+	VAO = VBO = EBO = 0;
+}
+
+void MeshRenderer::Draw(GLuint programID, const glm::mat4 &MVP)
+{
+	glUseProgram(programID);
+	GLint loc = glGetUniformLocation(programID, "u_mvp");
+	if (loc != -1)
+	{
+		glUniformMatrix4fv(loc, 1, GL_FALSE, &MVP[0][0]);
+	}
+
+	// Draw mesh
+	glBindVertexArray(this->VAO);
+	if (levels.empty())
+		glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+	else
+		glDrawElementsBaseVertex(GL_TRIANGLES, drawLevel.indexCount, GL_UNSIGNED_INT,
+								 (GLvoid *)(drawLevel.firstIndex * sizeof(GLuint)),
+								 drawLevel.baseVertex);
+	glBindVertexArray(0);
+}
+
+void MeshRenderer::DrawInstanced(const pmLevel &level, GLuint instanceBuffer, size_t firstInstance, GLsizei instanceCount)
+{
+	glBindVertexArray(this->VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+
+	// GL 3.3 has no base instance, so the matrix attributes are pointed at
+	// this draw's first instance instead
+	for (GLuint column = 0; column < 4; ++column)
+	{
+		glEnableVertexAttribArray(3 + column);
+		glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+							  (GLvoid *)(firstInstance * sizeof(glm::mat4) + column * sizeof(glm::vec4)));
+		glVertexAttribDivisor(3 + column, 1);
+	}
+
+	glDrawElementsInstancedBaseVertex(GL_TRIANGLES, level.indexCount, GL_UNSIGNED_INT,
+									  (GLvoid *)(level.firstIndex * sizeof(GLuint)),
+									  instanceCount, level.baseVertex);
+	glBindVertexArray(0);
+}
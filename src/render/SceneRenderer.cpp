@@ -0,0 +1,45 @@
+#include "core/Stats.h"
+#include "render/SceneRenderer.h"
+
+SceneRenderer::~SceneRenderer()
+{
+	if (instanceVBO)
+		glDeleteBuffers(1, &instanceVBO);
+}
+
+void SceneRenderer::Upload(const LodManager &lods)
+{
+	for (int a = static_cast<int>(assets.size()); a < lods.AssetCount(); ++a)
+	{
+		assets.push_back(std::make_unique<MeshRenderer>());
+		assets.back()->UploadLayout(lods.Layout(a));
+	}
+}
+
+void SceneRenderer::Draw(GLuint programID, const glm::mat4 &viewProj, const LodManager &lods)
+{
+	const std::vector<glm::mat4> &transforms = lods.DrawTransforms();
+	if (transforms.empty())
+		return;
+
+	if (!instanceVBO)
+		glGenBuffers(1, &instanceVBO);
+
+	// orphan last frame's transforms rather than wait for draws still using them
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+	if (transforms.size() > instanceCapacity)
+		instanceCapacity = transforms.size() + transforms.size() / 2;
+	glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(glm::mat4), nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, transforms.size() * sizeof(glm::mat4), transforms.data());
+	statAdd(Stat::BytesUploaded, transforms.size() * sizeof(glm::mat4));
+	statAdd(Stat::Uploads);
+
+	glUseProgram(programID);
+	GLint loc = glGetUniformLocation(programID, "u_viewProj");
+	if (loc != -1)
+		glUniformMatrix4fv(loc, 1, GL_FALSE, &viewProj[0][0]);
+
+	for (const LodDraw &draw : lods.Draws())
+		assets[draw.asset]->DrawInstanced(lods.Layout(draw.asset).levels[draw.level], instanceVBO,
+										  draw.firstInstance, static_cast<GLsizei>(draw.instanceCount));
+}
@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "scene/LodManager.h"
+
+namespace
+{
+	glm::vec4 row(const glm::mat4 &m, int i)
+	{
+		return glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+	}
+
+	// floor(4 * log2(t)) + kBucketOne, clamped, straight from the float's
+	// exponent and three mantissa compares
+	inline int toleranceBucket(float t)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &t, sizeof(bits));
+		int exponent = static_cast<int>(bits >> 23) - 127;
+
+		uint32_t mantissaBits = (bits & 0x007fffffu) | 0x3f800000u;
+		float mantissa;
+		std::memcpy(&mantissa, &mantissaBits, sizeof(mantissa));
+		int quarter = (mantissa >= 1.18920712f) + (mantissa >= 1.41421356f) + (mantissa >= 1.68179283f);
+
+		return std::clamp(4 * exponent + quarter + LodManager::kBucketOne, 0, LodManager::kBuckets - 1);
+	}
+}
+
+int LodManager::addAsset(const pMesh &pm, float levelRatio)
+{
+	Asset asset;
+	asset.layout = std::make_shared<const pmLayout>(buildPrefixLayout(pm, levelRatio));
+	const pmLayout &layout = *asset.layout;
+
+	// every level's vertices, so moved ones stay inside too
+	glm::vec3 lo(std::numeric_limits<float>::max()), hi(-std::numeric_limits<float>::max());
+	for (const Vertex &v : layout.vertices)
+	{
+		lo = glm::min(lo, v.Position);
+		hi = glm::max(hi, v.Position);
+	}
+	asset.center = layout.vertices.empty() ? glm::vec3(0.0f) : (lo + hi) * 0.5f;
+	asset.radius = 0.0f;
+	for (const Vertex &v : layout.vertices)
+		asset.radius = std::max(asset.radius, glm::length(v.Position - asset.center));
+
+	// errors only grow with the level, so the coarsest level within a
+	// bucket's lower edge is the last one at or under it
+	size_t levels = std::min<size_t>(layout.levels.size(), 256);
+	size_t level = 0;
+	for (int b = 0; b < kBuckets; ++b)
+	{
+		float tolerance = std::exp2((b - kBucketOne) * 0.25f);
+		while (level + 1 < levels && layout.levels[level + 1].error <= tolerance)
+			++level;
+		bucketLevel.push_back(static_cast<uint8_t>(level));
+		bucketTriangles.push_back(layout.levels[level].indexCount / 3);
+	}
+
+	asset.groupBase = groupCount;
+	groupCount += static_cast<uint32_t>(levels);
+
+	assets.push_back(std::move(asset));
+	return static_cast<int>(assets.size()) - 1;
+}
+
+int LodManager::addInstance(int asset, const glm::mat4 &transform)
+{
+	centerX.push_back(0.0f);
+	centerY.push_back(0.0f);
+	centerZ.push_back(0.0f);
+	radius.push_back(0.0f);
+	scale.push_back(1.0f);
+	assetOf.push_back(static_cast<uint32_t>(asset));
+	transforms.push_back(transform);
+
+	int instance = static_cast<int>(transforms.size()) - 1;
+	setTransform(instance, transform);
+	return instance;
+}
+
+void LodManager::setTransform(int instance, const glm::mat4 &transform)
+{
+	const Asset &asset = assets[assetOf[instance]];
+	glm::vec4 c = transform * glm::vec4(asset.center, 1.0f);
+	float s = std::max({glm::length(glm::vec3(transform[0])),
+						glm::length(glm::vec3(transform[1])),
+						glm::length(glm::vec3(transform[2]))});
+
+	centerX[instance] = c.x;
+	centerY[instance] = c.y;
+	centerZ[instance] = c.z;
+	radius[instance] = asset.radius * s;
+	scale[instance] = s > 0.0f ? s : 1.0f;
+	transforms[instance] = transform;
+}
+
+void LodManager::clearInstances()
+{
+	centerX.clear();
+	centerY.clear();
+	centerZ.clear();
+	radius.clear();
+	scale.clear();
+	assetOf.clear();
+	transforms.clear();
+}
+
+// triangles drawn with every visible instance `shift` buckets coarser
+uint64_t LodManager::trianglesAt(int shift) const
+{
+	uint64_t total = 0;
+	for (size_t key = 0; key < keyCount.size(); ++key)
+	{
+		if (keyCount[key] == 0)
+			continue;
+		int b = std::min(static_cast<int>(key & (kBuckets - 1)) + shift, kBuckets - 1);
+		total += static_cast<uint64_t>(keyCount[key]) * bucketTriangles[(key & ~size_t(kBuckets - 1)) + b];
+	}
+	return total;
+}
+
+void LodManager::update(const glm::mat4 &viewProj, const LodSettings &settings)
+{
+	const glm::vec4 r0 = row(viewProj, 0), r1 = row(viewProj, 1), r2 = row(viewProj, 2), r3 = row(viewProj, 3);
+	glm::vec4 planes[6] = {r3 + r0, r3 - r0, r3 + r1, r3 - r1, r3 + r2, r3 - r2};
+	for (glm::vec4 &p : planes)
+	{
+		float length = glm::length(glm::vec3(p));
+		if (length > 0.0f)
+			p = p / length;
+	}
+	const float depthSlope = glm::length(glm::vec3(r3));
+	const float pixelsPerUnit = glm::length(glm::vec3(r1)) * settings.viewportHeight * 0.5f;
+	// world units allowed per unit of clip depth
+	const float toleranceSlope = std::max(settings.pixelError, 1e-6f) / std::max(pixelsPerUnit, 1e-12f);
+
+	// cull and find each instance's bucket
+	const size_t count = transforms.size();
+	bucket.resize(count);
+	keyCount.assign(assets.size() * kBuckets, 0);
+	uint32_t visible = 0;
+	for (size_t i = 0; i < count; ++i)
+	{
+		const float x = centerX[i], y = centerY[i], z = centerZ[i], r = radius[i];
+
+		bool inside = true;
+		for (const glm::vec4 &p : planes)
+			inside &= p.x * x + p.y * y + p.z * z + p.w >= -r;
+
+		// nearest clip depth of the sphere, at or behind the eye means finest
+		float w = r3.x * x + r3.y * y + r3.z * z + r3.w - r * depthSlope;
+		float tolerance = std::max(w, 0.0f) * toleranceSlope / scale[i];
+
+		int32_t key = static_cast<int32_t>(assetOf[i]) * kBuckets + toleranceBucket(tolerance);
+		bucket[i] = inside ? key : -1;
+		keyCount[key] += inside;
+		visible += inside;
+	}
+
+	// the smallest shift that fits the budget, or the coarsest there is
+	int shift = 0;
+	uint64_t triangles = trianglesAt(0);
+	if (settings.triangleBudget > 0 && triangles > settings.triangleBudget)
+	{
+		int lo = 1, hi = kBuckets - 1;
+		while (lo < hi)
+		{
+			int mid = (lo + hi) / 2;
+			if (trianglesAt(mid) <= settings.triangleBudget)
+				hi = mid;
+			else
+				lo = mid + 1;
+		}
+		shift = lo;
+		triangles = trianglesAt(shift);
+	}
+
+	stats.visible = visible;
+	stats.triangles = triangles;
+	stats.toleranceScale = std::exp2(shift * 0.25f);
+
+	// group by asset and level, counting sort
+	groupStart.assign(groupCount + 1, 0);
+	for (size_t i = 0; i < count; ++i)
+	{
+		int32_t key = bucket[i];
+		if (key < 0)
+			continue;
+		uint32_t asset = static_cast<uint32_t>(key) / kBuckets;
+		int b = std::min((key & (kBuckets - 1)) + shift, kBuckets - 1);
+		int32_t group = static_cast<int32_t>(assets[asset].groupBase + bucketLevel[(key & ~(kBuckets - 1)) + b]);
+		bucket[i] = group;
+		groupStart[group + 1]++;
+	}
+	for (uint32_t g = 0; g < groupCount; ++g)
+		groupStart[g + 1] += groupStart[g];
+
+	draws.clear();
+	for (size_t a = 0; a < assets.size(); ++a)
+	{
+		uint32_t levels = static_cast<uint32_t>(std::min<size_t>(assets[a].layout->levels.size(), 256));
+		for (uint32_t l = 0; l < levels; ++l)
+		{
+			uint32_t g = assets[a].groupBase + l;
+			if (groupStart[g + 1] > groupStart[g])
+				draws.push_back({static_cast<int>(a), static_cast<int>(l), groupStart[g], groupStart[g + 1] - groupStart[g]});
+		}
+	}
+
+	drawTransforms.resize(visible);
+	for (size_t i = 0; i < count; ++i)
+		if (bucket[i] >= 0)
+			drawTransforms[groupStart[bucket[i]]++] = transforms[i];
+}
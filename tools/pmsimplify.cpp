@@ -0,0 +1,361 @@
+#include <stdio.h>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+#include <filesystem>
+#include <sstream>
+#include <stdexcept>
+#include <climits>
+#include <cmath>
+
+#include "core/Stats.h"
+#include "mesh/Mesh.h"
+#include "mesh/pMesh.h"
+#include "mesh/objLoader.h"
+#include "mesh/meshCluster.h"
+#include "mesh/pmFile.h"
+#include "mesh/pmStream.h"
+
+namespace fs = std::filesystem;
+
+/*
+	pmsimplify
+	Headless batch front end for the simplifier. Each input OBJ is loaded,
+	its full collapse history is built and the mesh is exported at the
+	requested LOD. Inputs are independent, so they are spread over worker
+	threads.
+*/
+
+struct Options
+{
+	std::vector<std::string> inputs;
+	std::string outputDir;
+	float ratio = 0.5f;
+	int targetVerts = -1;
+	int jobs = 0;
+	bool writeHistory = false;
+	bool writePM = false;
+	bool writeStream = false;
+	bool optimal = false;
+	float batchWindow = 0.0f;
+	std::string statsPath; // "-" for stdout
+	ObjLoadOptions load;
+	bool cluster = false;
+	ClusterOptions clusterOptions;
+};
+
+static void printUsage()
+{
+	std::cout << "usage: pmsimplify [options] <input.obj>...\n"
+			  << "  -o <dir>      output directory (default: next to each input)\n"
+			  << "  -r <ratio>    fraction of vertices to keep (default 0.5)\n"
+			  << "  -t <count>    absolute vertex count to keep, overrides -r\n"
+			  << "  -j <n>        number of worker threads (default: all cores)\n"
+			  << "  --history     also write the collapse history as <name>.history\n"
+			  << "  --pm          also write the binary progressive mesh as <name>.pm\n"
+			  << "  --stream      also write the streamable progressive mesh as <name>.pms\n"
+			  << "  --optimal     move the kept vertex to the quadric optimum instead of\n"
+			  << "                collapsing onto an existing vertex\n"
+			  << "  --batch <w>   collapse independent batches in parallel, looking at the\n"
+			  << "                cheapest w * (live vertices) candidates per round\n"
+			  << "                (e.g. 0.05; default 0: strict greedy order)\n"
+			  << "  --weld <eps>  merge positions closer than eps (0: exact duplicates)\n"
+			  << "  --seams       one vertex per distinct position, normal and uv, kept\n"
+			  << "                together along seams while simplifying\n"
+			  << "  --cluster <m> first stream the input (OBJ or STL) through grid\n"
+			  << "                clustering in at most m MB, for meshes larger than memory\n"
+			  << "  --cluster-tris <n>\n"
+			  << "                most triangles clustering keeps (default 2097152)\n"
+			  << "  --stats <f>   write simplifier counters, timers and memory per input\n"
+			  << "                as JSON to f, or stdout for -; inputs then run one at\n"
+			  << "                a time so the counters are each input's own\n";
+}
+
+// the whole of text as a finite number, else throws naming the option
+static double numberArg(const std::string &option, const std::string &text)
+{
+	size_t used = 0;
+	double value = 0.0;
+	try
+	{
+		value = std::stod(text, &used);
+	}
+	catch (const std::exception &)
+	{
+		used = 0;
+	}
+	if (used == 0 || used != text.size() || !std::isfinite(value))
+		throw std::invalid_argument("Bad value for " + option + ": " + text);
+	return value;
+}
+
+static int intArg(const std::string &option, const std::string &text)
+{
+	double value = numberArg(option, text);
+	if (value != std::floor(value) || value < INT_MIN || value > INT_MAX)
+		throw std::invalid_argument("Bad value for " + option + ": " + text);
+	return static_cast<int>(value);
+}
+
+static bool parseArgs(int argc, char *argv[], Options &opts)
+{
+	try
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			std::string arg = argv[i];
+			bool hasValue = i + 1 < argc;
+
+			if (arg == "-h" || arg == "--help")
+				return false;
+			else if (arg == "--history")
+				opts.writeHistory = true;
+			else if (arg == "--pm")
+				opts.writePM = true;
+			else if (arg == "--stream")
+				opts.writeStream = true;
+			else if (arg == "--optimal")
+				opts.optimal = true;
+			else if (arg == "--weld" && hasValue)
+				opts.load.weldEpsilon = static_cast<float>(numberArg(arg, argv[++i]));
+			else if (arg == "--seams")
+				opts.load.splitSeams = true;
+			else if (arg == "--cluster" && hasValue)
+			{
+				opts.cluster = true;
+				opts.clusterOptions.memoryBudget = static_cast<size_t>(std::max(1.0, numberArg(arg, argv[++i])) * (1 << 20));
+			}
+			else if (arg == "--cluster-tris" && hasValue)
+				opts.clusterOptions.maxTriangles = static_cast<size_t>(std::max(0, intArg(arg, argv[++i])));
+			else if (arg == "--stats" && hasValue)
+				opts.statsPath = argv[++i];
+			else if (arg == "--batch" && hasValue)
+				opts.batchWindow = static_cast<float>(numberArg(arg, argv[++i]));
+			else if (arg == "-o" && hasValue)
+				opts.outputDir = argv[++i];
+			else if (arg == "-r" && hasValue)
+				opts.ratio = static_cast<float>(numberArg(arg, argv[++i]));
+			else if (arg == "-t" && hasValue)
+				opts.targetVerts = intArg(arg, argv[++i]);
+			else if (arg == "-j" && hasValue)
+				opts.jobs = intArg(arg, argv[++i]);
+			else if (!arg.empty() && arg[0] == '-')
+			{
+				std::cerr << "Unknown option: " << arg << "\n";
+				return false;
+			}
+			else
+				opts.inputs.push_back(arg);
+		}
+	}
+	catch (const std::invalid_argument &e)
+	{
+		std::cerr << e.what() << "\n";
+		return false;
+	}
+
+	return !opts.inputs.empty();
+}
+
+// quoted and escaped for JSON
+static std::string jsonString(const std::string &s)
+{
+	std::string out = "\"";
+	for (char c : s)
+	{
+		if (c == '"' || c == '\\')
+			out += '\\';
+		if (static_cast<unsigned char>(c) < 0x20)
+		{
+			char code[8];
+			snprintf(code, sizeof(code), "\\u%04x", c);
+			out += code;
+		}
+		else
+			out += c;
+	}
+	return out + "\"";
+}
+
+static bool writeHistory(const pMesh &pm, const std::string &path)
+{
+	std::ofstream file(path);
+	if (!file)
+	{
+		std::cerr << "Failed to write history file: " << path << "\n";
+		return false;
+	}
+
+	// one collapse per line, in the order they were applied
+	file << "# from to\n";
+	for (const pVert &h : pm.History())
+		file << h.from << " " << h.to << "\n";
+
+	return static_cast<bool>(file);
+}
+
+// streams the input through grid clustering; note gets a summary for the report
+static Mesh loadClustered(const std::string &input, const ClusterOptions &options, std::string &note)
+{
+	std::vector<Vertex> vertices;
+	std::vector<Triangle> triangles;
+	ClusterStats cluster;
+	if (!clusterSimplify(input, options, vertices, triangles, &cluster))
+		return Mesh(std::vector<Vertex>(), std::vector<Triangle>());
+
+	char line[256];
+	snprintf(line, sizeof(line), " (clustered from %llu triangles, cell %g, %.1f MB peak)",
+			 static_cast<unsigned long long>(cluster.inputTriangles), cluster.cellSize,
+			 cluster.peakBytes / double(1 << 20));
+	note = line;
+	return Mesh(vertices, std::move(triangles));
+}
+
+// stats, when given, receives the input's JSON entry for --stats
+static bool processFile(const std::string &input, const Options &opts, std::string &report, std::string *stats)
+{
+	using clock = std::chrono::steady_clock;
+	auto start = clock::now();
+	if (stats)
+		statsReset();
+
+	std::string clustered;
+	Mesh mesh = opts.cluster ? loadClustered(input, opts.clusterOptions, clustered) : Mesh(input, opts.load);
+	if (mesh.NumVerts() == 0)
+	{
+		report = input + ": no vertices loaded";
+		return false;
+	}
+
+	if (opts.optimal)
+		mesh.setPlacement(Placement::Optimal);
+	SimplifyOptions simplify;
+	simplify.batchWindow = opts.batchWindow;
+	pMesh progressive(mesh, simplify);
+
+	int target = opts.targetVerts >= 0
+					 ? opts.targetVerts
+					 : static_cast<int>(progressive.MaxVerts() * opts.ratio);
+	target = std::clamp(target, progressive.MinVerts(), progressive.MaxVerts());
+	progressive.Update(target);
+
+	fs::path in(input);
+	fs::path outDir = opts.outputDir.empty() ? in.parent_path() : fs::path(opts.outputDir);
+	std::string stem = in.stem().string();
+
+	fs::path outObj = outDir / (stem + "_" + std::to_string(progressive.CurrentVerts()) + ".obj");
+	bool ok = saveOBJ(progressive.Current(), outObj.string());
+
+	if (ok && opts.writeHistory)
+		ok = writeHistory(progressive, (outDir / (stem + ".history")).string());
+
+	if (ok && opts.writePM)
+		ok = savePM(progressive, (outDir / (stem + ".pm")).string());
+
+	if (ok && opts.writeStream)
+		ok = savePMStream(progressive, (outDir / (stem + ".pms")).string());
+
+	double seconds = std::chrono::duration<double>(clock::now() - start).count();
+
+	report = input + ": " + std::to_string(progressive.MaxVerts()) + " -> " +
+			 std::to_string(progressive.CurrentVerts()) + " vertices" + clustered + ", " +
+			 std::to_string(progressive.HistorySize()) + " collapses, " +
+			 std::to_string(seconds) + "s -> " + outObj.string();
+
+	if (stats)
+	{
+		std::ostringstream entry;
+		char line[256];
+		snprintf(line, sizeof(line), "\"vertices\": %d, \"triangles\": %zu, \"collapses\": %d, \"seconds\": %.6f, ",
+				 progressive.MaxVerts(), mesh.getTriangles().size(), progressive.HistorySize(), seconds);
+		entry << "    {\"input\": " << jsonString(in.generic_string()) << ", " << line
+			  << "\"mesh_bytes\": " << mesh.memoryBytes() << ", \"progressive_bytes\": " << progressive.memoryBytes()
+			  << ",\n     \"stats\": ";
+		writeStatsJSON(entry, statsSnapshot(), "     ");
+		entry << "}";
+		*stats = entry.str();
+	}
+	return ok;
+}
+
+int main(int argc, char *argv[])
+{
+	Options opts;
+	if (!parseArgs(argc, argv, opts))
+	{
+		printUsage();
+		return 1;
+	}
+
+	if (!opts.outputDir.empty())
+		fs::create_directories(opts.outputDir);
+
+	int jobs = opts.jobs > 0 ? opts.jobs : static_cast<int>(std::thread::hardware_concurrency());
+	jobs = std::clamp(jobs, 1, static_cast<int>(opts.inputs.size()));
+	// the counters are process wide
+	const bool collectStats = !opts.statsPath.empty();
+	if (collectStats)
+		jobs = 1;
+	std::vector<std::string> statsEntries(opts.inputs.size());
+	// keep stdout for the JSON, the loaders report to std::cout too
+	std::ostream &log = opts.statsPath == "-" ? std::cerr : std::cout;
+	auto *stdoutBuffer = std::cout.rdbuf();
+	if (opts.statsPath == "-")
+		std::cout.rdbuf(std::cerr.rdbuf());
+
+	std::atomic<size_t> next{0};
+	std::atomic<int> failures{0};
+	std::mutex printLock;
+
+	auto worker = [&]()
+	{
+		for (size_t i = next++; i < opts.inputs.size(); i = next++)
+		{
+			std::string report;
+			bool ok = processFile(opts.inputs[i], opts, report, collectStats ? &statsEntries[i] : nullptr);
+			if (!ok)
+				failures++;
+
+			std::lock_guard<std::mutex> lock(printLock);
+			(ok ? log : std::cerr) << report << "\n";
+		}
+	};
+
+	std::vector<std::thread> pool;
+	for (int i = 0; i < jobs; ++i)
+		pool.emplace_back(worker);
+	for (auto &t : pool)
+		t.join();
+	std::cout.rdbuf(stdoutBuffer);
+
+	if (collectStats)
+	{
+		std::ofstream file;
+		if (opts.statsPath != "-")
+			file.open(opts.statsPath);
+		std::ostream &out = opts.statsPath == "-" ? std::cout : file;
+
+		out << "{\n  \"inputs\": [\n";
+		bool first = true;
+		for (const std::string &entry : statsEntries)
+			if (!entry.empty())
+			{
+				out << (first ? "" : ",\n") << entry;
+				first = false;
+			}
+		out << "\n  ]\n}\n";
+		if (!out)
+		{
+			std::cerr << "Failed to write stats: " << opts.statsPath << "\n";
+			failures++;
+		}
+	}
+
+	return failures > 0 ? 1 : 0;
+}